@@ -0,0 +1,54 @@
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include "alloccount.hpp"
+
+static thread_local size_t count = 0;
+static std::atomic<size_t> total(0);
+
+size_t threadAllocations()
+{
+    return count;
+}
+
+size_t processAllocations()
+{
+    return total.load();
+}
+
+void *operator new(size_t bytes)
+{
+    count++;
+    total.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(bytes ? bytes : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t bytes)
+{
+    return operator new(bytes);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+#endif
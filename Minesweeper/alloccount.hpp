@@ -0,0 +1,16 @@
+#ifndef alloccount_hpp
+#define alloccount_hpp
+
+#include <cstddef>
+
+// Counts calls to the global operator new, to check that code doesn't allocate.
+// alloccount.cpp replaces operator new for the whole program, so it is only
+// linked into the harness, when built with MINESWEEPER_COUNT_ALLOCATIONS.
+
+// Allocations made by the calling thread so far
+size_t threadAllocations();
+// Allocations made by every thread so far, including threads that aren't
+// the caller's to ask, like the solver's WorkPool
+size_t processAllocations();
+
+#endif /* alloccount_hpp */
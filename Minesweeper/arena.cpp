@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "arena.hpp"
+
+Arena::Arena(size_t blockSize)
+{
+    this->blockSize = blockSize;
+    current = 0;
+    used = 0;
+}
+
+Arena::~Arena()
+{
+    for (Block &block : blocks)
+        delete[] block.data;
+}
+
+void *Arena::allocate(size_t bytes, size_t align)
+{
+    while (true)
+    {
+        if (current < blocks.size())
+        {
+            size_t start = (used + align - 1) & ~(align - 1);
+            if (start + bytes <= blocks[current].size)
+            {
+                used = start + bytes;
+                return blocks[current].data + start;
+            }
+            
+            // Doesn't fit, so go on to the next block
+            if (current + 1 < blocks.size() || used > 0)
+            {
+                current++;
+                used = 0;
+                continue;
+            }
+        }
+        
+        // Out of blocks. Each new one is at least as big as all the others
+        // together, so there are only ever a few.
+        size_t size = std::max(std::max(blockSize, capacity()), bytes + align);
+        Block block = {new char[size], size};
+        blocks.push_back(block);
+        current = blocks.size() - 1;
+        used = 0;
+    }
+}
+
+void Arena::reset()
+{
+    if (current > 0)
+    {
+        size_t size = capacity();
+        for (Block &block : blocks)
+            delete[] block.data;
+        blocks.clear();
+        
+        Block block = {new char[size], size};
+        blocks.push_back(block);
+    }
+    
+    current = 0;
+    used = 0;
+}
+
+size_t Arena::capacity()
+{
+    size_t total = 0;
+    for (const Block &block : blocks)
+        total += block.size;
+    return total;
+}
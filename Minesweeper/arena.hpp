@@ -0,0 +1,84 @@
+#ifndef arena_hpp
+#define arena_hpp
+
+#include <cstddef>
+#include <vector>
+
+// Bump allocator for scratch memory that is all thrown away at once. Memory
+// comes from a list of blocks, and reset() makes all of it free again without
+// giving any back, so once an arena has grown to fit the biggest job it is
+// used for, allocating from it never calls operator new. Not thread safe.
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 1 << 16);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    
+    void *allocate(size_t bytes, size_t align);
+    // Frees everything allocated since the last reset. If that took more than
+    // one block, they are replaced by one block as big as all of them, so that
+    // next time one is enough.
+    void reset();
+    // Total size of the blocks
+    size_t capacity();
+    
+private:
+    struct Block
+    {
+        char *data;
+        size_t size;
+    };
+    
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current;
+    size_t used;
+};
+
+// Allocator for standard containers that takes memory from an arena and never
+// frees it. Without an arena it uses operator new like std::allocator, so that
+// containers that don't need to be fast don't need one.
+template <class T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+    
+    Arena *arena;
+    
+    ArenaAllocator() : arena(nullptr) {}
+    ArenaAllocator(Arena &arena) : arena(&arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+    
+    T *allocate(size_t n)
+    {
+        if (!arena)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    
+    void deallocate(T *p, size_t)
+    {
+        if (!arena)
+            ::operator delete(p);
+    }
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena == b.arena;
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena != b.arena;
+}
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif /* arena_hpp */
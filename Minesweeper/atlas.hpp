@@ -0,0 +1,20 @@
+#ifndef atlas_hpp
+#define atlas_hpp
+
+#include <SDL2/SDL.h>
+
+// Every image the game uses, packed into one PNG by mkatlas at build time
+// and compiled in, so nothing has to be loaded from images/
+
+struct AtlasImage
+{
+    const char *name;   // File name without .png
+    SDL_Rect rect;      // Where the image is in the atlas
+};
+
+extern const unsigned char atlasPNG[];
+extern const int atlasPNGSize;
+extern const AtlasImage atlasImages[];
+extern const int atlasImageCount;
+
+#endif /* atlas_hpp */
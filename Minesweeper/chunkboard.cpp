@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <utility>
+#include "chunkboard.hpp"
+#include "shared.hpp"
+
+// Rounds down, unlike /, so that chunk -1 covers x = -64 ... -1
+static int chunkCoord(int v)
+{
+    return v >= 0 ? v / CHUNK_SIZE : (v + 1) / CHUNK_SIZE - 1;
+}
+
+static int localIndex(int x, int y)
+{
+    return (y - chunkCoord(y) * CHUNK_SIZE) * CHUNK_SIZE + (x - chunkCoord(x) * CHUNK_SIZE);
+}
+
+static uint64_t chunkKey(int x, int y)
+{
+    return ((uint64_t)(uint32_t)chunkCoord(x) << 32) | (uint32_t)chunkCoord(y);
+}
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t h)
+{
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+ChunkBoard::ChunkBoard(uint64_t seed, double density)
+{
+    if (density < 0)
+        density = 0;
+    if (density > 0.5)
+        density = 0.5;
+    threshold = (uint64_t)(density * 18446744073709551616.0);
+    reset(seed);
+}
+
+void ChunkBoard::reset(uint64_t seed)
+{
+    this->seed = seed;
+    clock = 0;
+    flagCount = 0;
+    chunks.clear();
+}
+
+bool ChunkBoard::isMine(int x, int y)
+{
+    // The 3x3 square around the origin is where the game starts
+    if (x >= -1 && x <= 1 && y >= -1 && y <= 1)
+        return false;
+    
+    return mix(mix(seed ^ chunkKey(x, y)) + localIndex(x, y)) < threshold;
+}
+
+int ChunkBoard::countNumber(int x, int y)
+{
+    if (isMine(x, y))
+        return 9;
+    
+    int count = 0;
+    for (const auto &rp : relPos)
+        if (isMine(x + rp.x, y + rp.y))
+            count++;
+    return count;
+}
+
+void ChunkBoard::fillNumbers(Chunk &chunk, int x, int y)
+{
+    int originX = chunkCoord(x) * CHUNK_SIZE;
+    int originY = chunkCoord(y) * CHUNK_SIZE;
+    
+    chunk.numbers.resize(CHUNK_CELLS);
+    for (int i = 0; i < CHUNK_CELLS; i++)
+        chunk.numbers[i] = countNumber(originX + i % CHUNK_SIZE, originY + i / CHUNK_SIZE);
+}
+
+ChunkBoard::Chunk *ChunkBoard::findChunk(int x, int y)
+{
+    auto it = chunks.find(chunkKey(x, y));
+    if (it == chunks.end())
+        return nullptr;
+    
+    it->second.lastUse = ++clock;
+    return &it->second;
+}
+
+ChunkBoard::Chunk &ChunkBoard::touchChunk(int x, int y)
+{
+    Chunk *chunk = findChunk(x, y);
+    if (chunk != nullptr)
+        return *chunk;
+    
+    Chunk &newChunk = chunks[chunkKey(x, y)];
+    std::fill(newChunk.cellState, newChunk.cellState + CHUNK_CELLS, 0);
+    newChunk.lastUse = ++clock;
+    return newChunk;
+}
+
+int ChunkBoard::number(int x, int y)
+{
+    // Untouched chunks are never stored, so work it out from scratch
+    Chunk *chunk = findChunk(x, y);
+    if (chunk == nullptr)
+        return countNumber(x, y);
+    
+    if (chunk->numbers.empty())
+        fillNumbers(*chunk, x, y);
+    
+    return chunk->numbers[localIndex(x, y)];
+}
+
+unsigned int ChunkBoard::state(int x, int y)
+{
+    Chunk *chunk = findChunk(x, y);
+    return chunk == nullptr ? 0 : chunk->cellState[localIndex(x, y)];
+}
+
+int ChunkBoard::reveal(int x, int y)
+{
+    Chunk &first = touchChunk(x, y);
+    if (first.cellState[localIndex(x, y)] & REVEALED)
+        return 0;
+    
+    if (isMine(x, y))
+    {
+        first.cellState[localIndex(x, y)] = REVEALED;
+        return -1;
+    }
+    
+    std::vector<std::pair<int, int>> queue;
+    queue.push_back(std::make_pair(x, y));
+    
+    // Reveal as tiles are queued, so that nothing is queued twice
+    for (size_t left = 0; left < queue.size() && queue.size() < (size_t)MAX_FLOOD; left++)
+    {
+        int curX = queue[left].first;
+        int curY = queue[left].second;
+        
+        Chunk &chunk = touchChunk(curX, curY);
+        unsigned char &cell = chunk.cellState[localIndex(curX, curY)];
+        if (cell & FLAGGED)
+            flagCount--;
+        cell = REVEALED;
+        
+        if (number(curX, curY) != 0)
+            continue;
+        
+        for (const auto &rp : relPos)
+        {
+            int newX = curX + rp.x;
+            int newY = curY + rp.y;
+            
+            Chunk &neighbour = touchChunk(newX, newY);
+            unsigned char &newCell = neighbour.cellState[localIndex(newX, newY)];
+            if (!(newCell & REVEALED))
+            {
+                if (newCell & FLAGGED)
+                    flagCount--;
+                newCell = REVEALED;
+                queue.push_back(std::make_pair(newX, newY));
+            }
+        }
+    }
+    
+    return (int)queue.size();
+}
+
+void ChunkBoard::toggleFlag(int x, int y)
+{
+    unsigned char &cell = touchChunk(x, y).cellState[localIndex(x, y)];
+    if (cell & REVEALED)
+        return;
+    
+    flagCount += (cell & FLAGGED) ? -1 : 1;
+    cell ^= FLAGGED;
+}
+
+int ChunkBoard::flags()
+{
+    return flagCount;
+}
+
+void ChunkBoard::exportWindow(int x, int y, int ncols, int nrows,
+                              int *board, unsigned int *cellState, bool clip)
+{
+    for (int row = 0; row < nrows; row++)
+    {
+        for (int col = 0; col < ncols; col++)
+        {
+            int loc = row * ncols + col;
+            board[loc] = number(x + col, y + row);
+            cellState[loc] = state(x + col, y + row);
+            
+            bool rim = row == 0 || col == 0 || row == nrows - 1 || col == ncols - 1;
+            if (clip && rim && (cellState[loc] & REVEALED))
+                cellState[loc] = CLIPPED;
+        }
+    }
+}
+
+void ChunkBoard::evictCold(size_t maxCached)
+{
+    std::vector<Chunk *> cached;
+    for (auto &p : chunks)
+        if (!p.second.numbers.empty())
+            cached.push_back(&p.second);
+    
+    if (cached.size() <= maxCached)
+        return;
+    
+    // Oldest first
+    std::sort(cached.begin(), cached.end(), [](const Chunk *a, const Chunk *b) {
+        return a->lastUse < b->lastUse;
+    });
+    
+    for (size_t i = 0; i < cached.size() - maxCached; i++)
+        std::vector<unsigned char>().swap(cached[i]->numbers);
+}
+
+size_t ChunkBoard::chunkCount()
+{
+    return chunks.size();
+}
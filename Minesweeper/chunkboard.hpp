@@ -0,0 +1,71 @@
+#ifndef chunkboard_hpp
+#define chunkboard_hpp
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+const int CHUNK_SIZE = 64;
+const int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+// Flood fills stop after this many tiles, so that a sparse board
+// can't turn one click into an endless reveal
+const int MAX_FLOOD = 1 << 20;
+
+// Board for infinite minesweeper, split into CHUNK_SIZE x CHUNK_SIZE chunks.
+// Whether a tile is a mine is a pure function of the seed and the tile's chunk
+// coordinates, so a chunk is only stored once the player changes a tile in it.
+// The numbers of a stored chunk are cached, and can be dropped again when the
+// chunk goes cold. Memory is proportional to the explored area.
+class ChunkBoard
+{
+public:
+    // density is the chance of any tile being a mine
+    ChunkBoard(uint64_t seed, double density);
+    // Forgets every chunk and starts over with a new seed
+    void reset(uint64_t seed);
+    
+    // Same as board[] on a finite board: number of adjacent mines, 9 if a mine
+    int number(int x, int y);
+    // Same as cellState[] on a finite board
+    unsigned int state(int x, int y);
+    
+    // Reveals x, y and flood fills from it like on a finite board.
+    // Returns number of tiles revealed, or -1 if x, y is a mine.
+    int reveal(int x, int y);
+    void toggleFlag(int x, int y);
+    int flags();
+    
+    // Copies the ncols x nrows window with top left corner x, y into board and
+    // cellState. If clip is set, revealed tiles on the rim of the window are
+    // marked CLIPPED, so a Solver given the window won't trust their numbers.
+    void exportWindow(int x, int y, int ncols, int nrows,
+                      int *board, unsigned int *cellState, bool clip);
+    
+    // Drops the cached numbers of the least recently used chunks
+    // until at most maxCached chunks have numbers cached
+    void evictCold(size_t maxCached);
+    size_t chunkCount();
+
+private:
+    struct Chunk
+    {
+        unsigned char cellState[CHUNK_CELLS];
+        std::vector<unsigned char> numbers; // Empty when evicted
+        unsigned long lastUse;
+    };
+    
+    uint64_t seed;
+    uint64_t threshold;
+    unsigned long clock;
+    int flagCount;
+    std::unordered_map<uint64_t, Chunk> chunks;
+    
+    bool isMine(int x, int y);
+    int countNumber(int x, int y);
+    void fillNumbers(Chunk &chunk, int x, int y);
+    Chunk *findChunk(int x, int y);
+    Chunk &touchChunk(int x, int y);
+};
+
+#endif /* chunkboard_hpp */
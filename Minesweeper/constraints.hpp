@@ -0,0 +1,151 @@
+#ifndef constraints_hpp
+#define constraints_hpp
+
+#include <algorithm>
+#include "arena.hpp"
+
+// A revealed tile's number, as a constraint on the unrevealed tiles of a
+// component: exactly mines of the tiles are mines. tiles are indices into
+// the component's unrevealed tiles.
+struct Constraint
+{
+    ArenaVector<int> tiles;
+    int mines;
+    
+    Constraint() : mines(0) {}
+    explicit Constraint(Arena &arena) : tiles(arena), mines(0) {}
+};
+
+// A component's constraints laid out for searching, in flat arrays indexed by
+// constraint and by tile, so that deciding a tile only touches the few
+// constraints on it. The constraints on tile i are constraintsOf[first[i]]
+// to constraintsOf[first[i + 1] - 1].
+struct ConstraintGraph
+{
+    // Per constraint: mines still to place, and tiles still to decide
+    ArenaVector<int> remaining;
+    ArenaVector<int> undecided;
+    ArenaVector<int> first;
+    ArenaVector<int> constraintsOf;
+    
+    ConstraintGraph(Arena &arena, int nTiles, const ArenaVector<Constraint> &constraints)
+        : remaining(arena), undecided(arena), first(nTiles + 1, 0, arena), constraintsOf(arena)
+    {
+        for (const Constraint &constraint : constraints)
+        {
+            remaining.push_back(constraint.mines);
+            undecided.push_back((int)constraint.tiles.size());
+            for (const int &tile : constraint.tiles)
+                first[tile + 1] += 1;
+        }
+        for (int i = 0; i < nTiles; i++)
+            first[i + 1] += first[i];
+        
+        ArenaVector<int> next(first.begin(), first.end() - 1, arena);
+        constraintsOf.resize(first[nTiles]);
+        for (size_t c = 0; c < constraints.size(); c++)
+            for (const int &tile : constraints[c].tiles)
+                constraintsOf[next[tile]++] = (int)c;
+    }
+    
+    int tiles() const
+    {
+        return (int)first.size() - 1;
+    }
+    
+    // Makes tile a mine or not. Returns false if that leaves a constraint on
+    // it with too many mines or too few tiles left for its mines, but updates
+    // every constraint either way, so undo always has to follow.
+    bool decide(int tile, int mine)
+    {
+        bool fits = true;
+        for (int j = first[tile]; j < first[tile + 1]; j++)
+        {
+            int c = constraintsOf[j];
+            remaining[c] -= mine;
+            undecided[c] -= 1;
+            if (remaining[c] < 0 || remaining[c] > undecided[c])
+                fits = false;
+        }
+        return fits;
+    }
+    
+    void undo(int tile, int mine)
+    {
+        for (int j = first[tile]; j < first[tile + 1]; j++)
+        {
+            int c = constraintsOf[j];
+            remaining[c] += mine;
+            undecided[c] += 1;
+        }
+    }
+};
+
+// Results of solving a component, split by how many mines a configuration
+// has so that the total number of mines on the board can be accounted for.
+// configs[k] is the number of valid configurations with k mines, and
+// mines[i][k] and safes[i][k] how many of those have a mine / no mine at
+// tile i. Counts are doubles since they can get bigger than any integer,
+// and the counts of long strips are bigger than any double, so every count
+// is also multiplied by exp(logScale).
+struct Counts
+{
+    ArenaVector<double> configs;
+    ArenaVector<ArenaVector<double>> mines;
+    ArenaVector<ArenaVector<double>> safes;
+    double logScale = 0;
+    
+    Counts() {}
+    explicit Counts(Arena &arena) : configs(arena), mines(arena), safes(arena) {}
+    
+    void reset(int nTiles)
+    {
+        configs.assign(nTiles + 1, 0);
+        ArenaVector<double> zeros(nTiles + 1, 0, configs.get_allocator());
+        mines.assign(nTiles, zeros);
+        safes.assign(nTiles, zeros);
+        logScale = 0;
+    }
+    
+    // Zeroes every count, keeping the memory
+    void clear()
+    {
+        std::fill(configs.begin(), configs.end(), 0);
+        for (size_t i = 0; i < mines.size(); i++)
+        {
+            std::fill(mines[i].begin(), mines[i].end(), 0);
+            std::fill(safes[i].begin(), safes[i].end(), 0);
+        }
+        logScale = 0;
+    }
+    
+    // Adds a configuration of the tiles, config[i] being 1 for a mine, with k mines
+    void add(const ArenaVector<int> &config, int k, double weight)
+    {
+        configs[k] += weight;
+        for (size_t i = 0; i < config.size(); i++)
+        {
+            if (config[i])
+                mines[i][k] += weight;
+            else
+                safes[i][k] += weight;
+        }
+    }
+    
+    // other must have the same logScale
+    void add(const Counts &other)
+    {
+        for (size_t k = 0; k < configs.size(); k++)
+            configs[k] += other.configs[k];
+        for (size_t i = 0; i < mines.size(); i++)
+        {
+            for (size_t k = 0; k < configs.size(); k++)
+            {
+                mines[i][k] += other.mines[i][k];
+                safes[i][k] += other.safes[i][k];
+            }
+        }
+    }
+};
+
+#endif /* constraints_hpp */
@@ -0,0 +1,159 @@
+#include "game.hpp"
+#include "shared.hpp"
+
+Game::Game(int ncols, int nrows, int nMines)
+{
+    this->ncols = ncols;
+    this->nrows = nrows;
+    this->nMines = nMines;
+    size = ncols * nrows;
+    board.assign(size, -1);
+    cellState.assign(size, 0);
+    reset(0);
+}
+
+void Game::reset(unsigned int seed)
+{
+    rng.seed(seed);
+    placed = false;
+    hitMine = false;
+    unrevealedCount = size;
+    
+    // Set all tiles to unrevealed/unflagged.
+    for (unsigned int &cell : cellState)
+        cell = 0;
+}
+
+int Game::countAdjacentMines(int loc)
+{
+    int count = 0;
+    for (const auto &rp : relPos)
+    {
+        int row = loc / ncols;
+        int col = loc % ncols;
+        
+        row += rp.y;
+        col += rp.x;
+        
+        if (col >= 0 && col < ncols && row >= 0 && row < nrows)
+            if (board[(row * ncols) + col] == 9)
+                count++;
+    }
+    
+    return count;
+}
+
+void Game::placeMines(int firstTile)
+{
+    std::vector<int> mineLocations(size);
+    
+    // Reset to empty board
+    for (int &cell : board)
+        cell = -1;
+    
+    for (int i = 0; i < firstTile; i++)
+        mineLocations[i] = i;
+    
+    for (int i = firstTile + 1; i < size; i++)
+        mineLocations[i - 1] = i;
+    
+    for (int i = 0; i < nMines; i++)
+    {
+        int n = rng() % ((size - 1) - i);
+        
+        board[mineLocations[n]] = 9;
+        
+        mineLocations[n] = mineLocations[(size - 2) - i];
+    }
+    
+    // Fill in the rest of the board accordingly
+    for (int i = 0; i < size; i++)
+        if (board[i] != 9)
+            board[i] = countAdjacentMines(i);
+    
+    placed = true;
+}
+
+bool Game::minesPlaced()
+{
+    return placed;
+}
+
+int Game::floodFill(int loc, int *queue)
+{
+    std::vector<bool> visited(size, false);
+    int left = 0;
+    int right = 0;
+    
+    queue[right++] = loc;
+    visited[loc] = true;
+    
+    while (left < right)
+    {
+        int curLoc = queue[left++];
+        if (board[curLoc] == 0)
+        {
+            for (const auto &rp : relPos)
+            {
+                int row = curLoc / ncols;
+                int col = curLoc % ncols;
+                
+                row += rp.y;
+                col += rp.x;
+                
+                if (col >= 0 && col < ncols && row >= 0 && row < nrows)
+                {
+                    int newLoc = (row * ncols) + col;
+                    
+                    if (!visited[newLoc] && cellState[newLoc] != REVEALED)
+                    {
+                        queue[right++] = newLoc;
+                        visited[newLoc] = true;
+                    }
+                }
+            }
+        }
+    }
+    
+    return right;
+}
+
+int Game::reveal(int loc)
+{
+    if (!placed)
+        placeMines(loc);
+    
+    if (cellState[loc] & REVEALED)
+        return 0;
+    
+    if (board[loc] == 9)
+    {
+        cellState[loc] = REVEALED;
+        hitMine = true;
+        return -1;
+    }
+    
+    std::vector<int> queue(size);
+    int count = floodFill(loc, queue.data());
+    for (int i = 0; i < count; i++)
+        cellState[queue[i]] = REVEALED;
+    
+    unrevealedCount -= count;
+    return count;
+}
+
+void Game::toggleFlag(int loc)
+{
+    if (!(cellState[loc] & REVEALED))
+        cellState[loc] ^= FLAGGED;
+}
+
+bool Game::won()
+{
+    return !hitMine && unrevealedCount == nMines;
+}
+
+bool Game::lost()
+{
+    return hitMine;
+}
@@ -0,0 +1,50 @@
+#ifndef game_hpp
+#define game_hpp
+
+#include <random>
+#include <vector>
+
+// The rules of the game, without any graphics. Mines are placed on the first
+// reveal so that the first tile revealed is never a mine.
+class Game
+{
+public:
+    Game(int ncols, int nrows, int nMines);
+    // Starts over with an empty board. Mines will be placed using seed.
+    void reset(unsigned int seed);
+    // Places mines anywhere but firstTile
+    void placeMines(int firstTile);
+    bool minesPlaced();
+    
+    // Fills queue with the tiles revealing loc opens up, in the order
+    // they open, without revealing them. Returns how many there are.
+    int floodFill(int loc, int *queue);
+    // Reveals loc and everything floodFill finds, placing mines first if needed.
+    // Returns number of tiles revealed, or -1 if loc is a mine.
+    int reveal(int loc);
+    void toggleFlag(int loc);
+    bool won();
+    bool lost();
+    
+    int ncols;
+    int nrows;
+    int nMines;
+    int size;
+    
+    // Counts number of mines. If 9, then it is a mine
+    std::vector<int> board;
+    
+    // cellState[loc] = 0 means unrevealed
+    // cellState[loc] = 1 means revealed
+    // cellState[loc] = 2 means flagged
+    std::vector<unsigned int> cellState;
+
+private:
+    std::mt19937 rng;
+    bool placed;
+    bool hitMine;
+    int unrevealedCount;
+    int countAdjacentMines(int loc);
+};
+
+#endif /* game_hpp */
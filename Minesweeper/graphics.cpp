@@ -4,6 +4,9 @@
 #include <vector>
 #include "graphics.hpp"
 #include "shared.hpp"
+#ifdef MINESWEEPER_EMBEDDED_ATLAS
+#include "atlas.hpp"
+#endif
 
 // Window we render to
 SDL_Window *window = nullptr;
@@ -11,9 +14,14 @@ SDL_Window *window = nullptr;
 // The window renderer
 SDL_Renderer *renderer = nullptr;
 
+// What the renderer draws into when there is no window
+SDL_Surface *framebuffer = nullptr;
+
 Texture::Texture()
 {
     texture = nullptr;
+    region = {0, 0, 0, 0};
+    owned = false;
     width = 0;
     height = 0;
 }
@@ -27,42 +35,73 @@ bool Texture::loadFromFile(std::string path)
 {
     // Get rid of preexisting texture
     free();
-    SDL_Texture* newTexture = nullptr;
     
     SDL_Surface *loadedSurface = IMG_Load(path.c_str());
     if (loadedSurface == nullptr)
     {
         printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+        return false;
+    }
+    
+    SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+    return loadFromSurface(loadedSurface, path);
+}
+
+bool Texture::loadFromMemory(const void *data, int size)
+{
+    free();
+    
+    SDL_Surface *loadedSurface = IMG_Load_RW(SDL_RWFromConstMem(data, size), 1);
+    if (loadedSurface == nullptr)
+    {
+        printf("Unable to load image from memory! SDL_image Error: %s\n", IMG_GetError());
+        return false;
+    }
+    
+    return loadFromSurface(loadedSurface, "memory");
+}
+
+// Uploads surface to a texture of its own and frees surface
+bool Texture::loadFromSurface(SDL_Surface *surface, const std::string &name)
+{
+    texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (texture == nullptr)
+    {
+        printf("Unable to create texture from %s! SDL Error: %s\n", name.c_str(), SDL_GetError());
     }
     else
     {
-        SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-        newTexture = SDL_CreateTextureFromSurface(renderer, loadedSurface);
-        if (newTexture == nullptr)
-        {
-            printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
-        }
-        else
-        {
-            width = loadedSurface->w;
-            height = loadedSurface->h;
-        }
-        
-        SDL_FreeSurface(loadedSurface);
+        owned = true;
+        width = surface->w;
+        height = surface->h;
+        region = {0, 0, width, height};
     }
     
+    SDL_FreeSurface(surface);
+    
     // Return success
-    texture = newTexture;
     return texture != nullptr;
 }
 
+void Texture::useRegion(const Texture &atlas, SDL_Rect rect)
+{
+    free();
+    texture = atlas.texture;
+    owned = false;
+    region = rect;
+    width = rect.w;
+    height = rect.h;
+}
+
 void Texture::free()
 {
-    // Free texture if it exists
+    // Free texture if it exists and isn't someone else's
     if (texture != nullptr)
     {
-        SDL_DestroyTexture(texture);
+        if (owned)
+            SDL_DestroyTexture(texture);
         texture = nullptr;
+        owned = false;
         width = 0;
         height = 0;
     }
@@ -72,7 +111,7 @@ void Texture::render(int x, int y)
 {
     // Set rendering space and render to screen
     SDL_Rect renderQuad = {x, y, width, height};
-    SDL_RenderCopy(renderer, texture, nullptr, &renderQuad);
+    SDL_RenderCopy(renderer, texture, &region, &renderQuad);
 }
 
 int Texture::getWidth()
@@ -139,15 +178,82 @@ bool init()
     return success;
 }
 
+bool initHeadless(int width, int height)
+{
+    // Nothing needs the video subsystem without a window
+    if (SDL_Init(0) < 0)
+    {
+        printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    
+    // Queue draw calls and hand them to the renderer together
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+    
+    framebuffer = SDL_CreateRGBSurfaceWithFormat(0, width, height, 24, SDL_PIXELFORMAT_RGB24);
+    if (framebuffer == nullptr)
+    {
+        printf("Framebuffer could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    
+    renderer = SDL_CreateSoftwareRenderer(framebuffer);
+    if (renderer == nullptr)
+    {
+        printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderClear(renderer);
+    
+    int imflags = IMG_INIT_PNG;
+    if (!(IMG_Init(imflags) & imflags))
+    {
+        printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+        return false;
+    }
+    
+    return true;
+}
+
+// Makes texture the image called name, from the atlas if there is one
+// and otherwise from images/name.png
+static bool loadImage(const TextureStruct &textures, Texture &texture, const std::string &name)
+{
+#ifdef MINESWEEPER_EMBEDDED_ATLAS
+    for (int i = 0; i < atlasImageCount; i++)
+    {
+        if (name == atlasImages[i].name)
+        {
+            texture.useRegion(textures.atlas, atlasImages[i].rect);
+            return true;
+        }
+    }
+    printf("Image %s is not in the atlas!\n", name.c_str());
+    return false;
+#else
+    return texture.loadFromFile("images/" + name + ".png");
+#endif
+}
+
 bool loadMedia(TextureStruct &textures)
 {
     bool success = true;
     
+#ifdef MINESWEEPER_EMBEDDED_ATLAS
+    // Decoded and uploaded once, for every image to use part of
+    if (!textures.atlas.loadFromMemory(atlasPNG, atlasPNGSize))
+    {
+        printf("Failed to load the atlas!\n");
+        return false;
+    }
+#endif
+    
     std::vector<std::string> numbers = {"one", "two", "three", "four", "five", "six", "seven", "eight"};
     for (int i = 0; i < numbers.size(); i++)
     {
-        auto path = std::string("images/") + numbers[i] + ".png";
-        if (!textures.numbers[i].loadFromFile(path))
+        if (!loadImage(textures, textures.numbers[i], numbers[i]))
         {
             printf("Failed to load %s.png\n", numbers[i].c_str());
             success = false;
@@ -156,51 +262,50 @@ bool loadMedia(TextureStruct &textures)
     
     for (int i = 0; i < 10; i++)
     {
-        auto path = std::string("images/counter_") + std::to_string(i) + ".png";
-        if (!textures.counterNumbers[i].loadFromFile(path))
+        if (!loadImage(textures, textures.counterNumbers[i], "counter_" + std::to_string(i)))
         {
             printf("Failed to load counter_%d.png!\n", i);
             success = false;
         }
     }
     
-    if(!textures.flag.loadFromFile("images/flag.png"))
+    if(!loadImage(textures, textures.flag, "flag"))
     {
         printf("Failed to load flag.png!\n");
         success = false;
     }
     
-    if(!textures.mine.loadFromFile("images/mine.png"))
+    if(!loadImage(textures, textures.mine, "mine"))
     {
         printf("Failed to load mine.png!\n");
         success = false;
     }
     
-    if (!textures.unrevealed.loadFromFile("images/unrevealed.png"))
+    if (!loadImage(textures, textures.unrevealed, "unrevealed"))
     {
         printf("Failed to load unrevealed.png!\n");
         success = false;
     }
     
-    if (!textures.dead.loadFromFile("images/dead_face.png"))
+    if (!loadImage(textures, textures.dead, "dead_face"))
     {
         printf("Failed to load dead_face.png!\n");
         success = false;
     }
     
-    if (!textures.happy.loadFromFile("images/happy_face.png"))
+    if (!loadImage(textures, textures.happy, "happy_face"))
     {
         printf("Failed to load happy_face.png!\n");
         success = false;
     }
     
-    if (!textures.glasses.loadFromFile("images/glasses_face.png"))
+    if (!loadImage(textures, textures.glasses, "glasses_face"))
     {
         printf("Failed to load glasses_face.png!\n");
         success = false;
     }
     
-    if (!textures.lightBulb.loadFromFile("images/light_bulb.png"))
+    if (!loadImage(textures, textures.lightBulb, "light_bulb"))
     {
         printf("Failed to load light_bulb.png!\n");
         success = false;
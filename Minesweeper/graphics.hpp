@@ -2,7 +2,11 @@
 #define graphics_hpp
 
 #include <SDL2/SDL.h>
+#ifdef __APPLE__
 #include <SDL2_image/SDL_image.h>
+#else
+#include <SDL2/SDL_image.h>
+#endif
 #include <string>
 
 // Wrapper around SDL_Texture
@@ -12,23 +16,43 @@ public:
     Texture();
     ~Texture();
     bool loadFromFile(std::string path);
+    // Loads a PNG that is already in memory
+    bool loadFromMemory(const void *data, int size);
+    // Makes this the part of atlas inside rect. It shares atlas's texture,
+    // so atlas has to outlive it.
+    void useRegion(const Texture &atlas, SDL_Rect rect);
     void free();
     void render(int x, int y);
     int getWidth();
     int getHeight();
-    
+
 private:
     SDL_Texture *texture; // The actual hardware texture
+    SDL_Rect region;      // The part of it that is this texture
+    bool owned;           // Whether free() destroys texture
     int width;
     int height;
+    
+    bool loadFromSurface(SDL_Surface *surface, const std::string &name);
 };
 
+// The window renderer
+extern SDL_Renderer *renderer;
+
 // Starts SDL and creates window
 bool init();
 
+// Starts SDL without a window, with a software renderer that draws into an
+// in-memory width x height RGB24 framebuffer. Draw calls are batched, so
+// call SDL_RenderFlush before reading the framebuffer's pixels.
+bool initHeadless(int width, int height);
+extern SDL_Surface *framebuffer;
+
 // Struct with all textures
 struct TextureStruct
 {
+    // With MINESWEEPER_EMBEDDED_ATLAS, every other texture is a region of this one
+    Texture atlas;
     Texture counterNumbers[10];
     Texture numbers[8];
     Texture flag;
@@ -40,7 +64,8 @@ struct TextureStruct
     Texture lightBulb;
 };
 
-// Loads media
+// Loads media, from the atlas compiled into the program if it was built
+// with MINESWEEPER_EMBEDDED_ATLAS and otherwise from images/
 bool loadMedia(TextureStruct &textures);
 
 #endif /* graphics_hpp */
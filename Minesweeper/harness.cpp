@@ -0,0 +1,373 @@
+// Plays two or more solver configurations on the same boards, with the same
+// first click, and reports whether the differences between them are real.
+//
+// harness [-games N] [-batch N] [-threads N] [-seed N] [-alpha A]
+//         [-board COLS ROWS MINES] config config ...
+//
+// A config is a comma separated list of solver options, as for parseOptions:
+//   safest    guess the tile least likely to be a mine
+//   random    guess any unrevealed tile
+//   lookahead guess the safe-looking tile most likely to lead to another safe move (default)
+//   ply2      look two moves ahead instead of one
+//   nostrips  always search instead of using countStrip
+//   nocount   ignore the number of mines left on the board
+//   sample    sample every component countStrip can't count, instead of searching
+//   nosample  always search, however big the search
+//
+// Built with MINESWEEPER_COUNT_ALLOCATIONS, it also counts the allocations
+// made by the solver on the thread playing the game, and reports them for all
+// games and for the last batch, by when every thread's solver is warmed up.
+// Allocations on the solver's pool threads can't be told apart by game, so
+// they are reported once, per move of every config.
+//
+// Games are played in batches. After each batch every config is compared to
+// the first with a paired test on win rate, and the harness stops once every
+// difference is significant. Every check uses alpha divided by the most checks
+// there could be, so stopping early doesn't inflate the false positive rate.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "game.hpp"
+#include "solver.hpp"
+#include "options.hpp"
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+#include "alloccount.hpp"
+#endif
+
+// 95% confidence intervals
+const double Z = 1.96;
+
+struct Config
+{
+    std::string name;
+    SolverOptions options;
+};
+
+struct Result
+{
+    bool won;
+    int moves;
+    int guesses;
+    double seconds;
+    size_t allocations;
+};
+
+static bool parseConfig(const std::string &name, Config &config)
+{
+    config.name = name;
+    config.options.verbose = false;
+    return parseOptions(name, config.options);
+}
+
+// Every thread reuses one solver, like a program solving many positions would
+static Result play(Solver &solver, const SolverOptions &options, int ncols, int nrows, int nMines, unsigned int seed)
+{
+    auto start = std::chrono::steady_clock::now();
+    Result result = {false, 0, 0, 0, 0};
+    
+    Game game(ncols, nrows, nMines);
+    game.reset(seed);
+    solver.setBoard(game.board.data(), game.cellState.data(), ncols, nrows, nMines);
+    solver.setOptions(options);
+    solver.seed(seed);
+    
+    // The first click comes from the seed too, so every config gets the same one
+    game.reveal(std::mt19937(seed)() % game.size);
+    
+    while (!game.won() && !game.lost() && result.moves < 2 * game.size)
+    {
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+        size_t allocations = threadAllocations();
+#endif
+        int loc = solver.singleSquare();
+        if (loc == -1)
+        {
+            loc = solver.multiSquare();
+            if (solver.guessed())
+                result.guesses++;
+        }
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+        result.allocations += threadAllocations() - allocations;
+#endif
+        if (loc == -1)
+            break;
+        
+        result.moves++;
+        if (loc >= game.size)
+            game.toggleFlag(loc - game.size);
+        else
+            game.reveal(loc);
+    }
+    
+    result.won = game.won();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Mean and half width of its confidence interval
+static void meanInterval(const std::vector<double> &values, double &mean, double &half)
+{
+    double n = (double)values.size();
+    mean = 0;
+    for (const double &v : values)
+        mean += v;
+    mean /= n;
+    
+    double variance = 0;
+    for (const double &v : values)
+        variance += (v - mean) * (v - mean);
+    variance /= std::max(1.0, n - 1);
+    
+    half = Z * sqrt(variance / n);
+}
+
+// Wilson score interval for a proportion
+static void wilson(int successes, int n, double &low, double &high)
+{
+    double p = (double)successes / n;
+    double centre = (p + Z * Z / (2 * n)) / (1 + Z * Z / n);
+    double half = Z * sqrt(p * (1 - p) / n + Z * Z / (4.0 * n * n)) / (1 + Z * Z / n);
+    low = centre - half;
+    high = centre + half;
+}
+
+// Two sided McNemar test. b and c are the games only the first / only
+// the second config won; under no difference each is Binomial(b + c, 1/2).
+static double mcnemar(int b, int c)
+{
+    int n = b + c;
+    if (n == 0)
+        return 1;
+    
+    // Exact for few discordant games
+    if (n < 50)
+    {
+        double tail = 0;
+        for (int i = 0; i <= std::min(b, c); i++)
+            tail += exp(lgamma(n + 1.0) - lgamma(i + 1.0) - lgamma(n - i + 1.0) - n * log(2.0));
+        return std::min(1.0, 2 * tail);
+    }
+    
+    double z = (fabs((double)(b - c)) - 1) / sqrt((double)n);
+    return erfc(z / sqrt(2.0));
+}
+
+static void usage()
+{
+    printf("Usage: harness [-games N] [-batch N] [-threads N] [-seed N] [-alpha A]\n"
+           "               [-board COLS ROWS MINES] config config ...\n"
+           "A config is a comma separated list of:\n"
+           "  safest random lookahead ply2 nostrips nocount sample nosample\n");
+}
+
+int main(int argc, char *args[])
+{
+    int maxGames = 10000;
+    int batch = 500;
+    int nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    unsigned int firstSeed = 1;
+    double alpha = 0.05;
+    int ncols = 16;
+    int nrows = 16;
+    int nMines = 40;
+    std::vector<Config> configs;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(args[i], "-games") && i + 1 < argc)
+            maxGames = atoi(args[++i]);
+        else if (!strcmp(args[i], "-batch") && i + 1 < argc)
+            batch = atoi(args[++i]);
+        else if (!strcmp(args[i], "-threads") && i + 1 < argc)
+            nThreads = atoi(args[++i]);
+        else if (!strcmp(args[i], "-seed") && i + 1 < argc)
+            firstSeed = (unsigned int)strtoul(args[++i], nullptr, 10);
+        else if (!strcmp(args[i], "-alpha") && i + 1 < argc)
+            alpha = atof(args[++i]);
+        else if (!strcmp(args[i], "-board") && i + 3 < argc)
+        {
+            ncols = atoi(args[++i]);
+            nrows = atoi(args[++i]);
+            nMines = atoi(args[++i]);
+        }
+        else
+        {
+            Config config;
+            if (!parseConfig(args[i], config))
+            {
+                printf("Unknown config %s\n", args[i]);
+                usage();
+                return 1;
+            }
+            configs.push_back(config);
+        }
+    }
+    
+    if (configs.size() < 2 || maxGames < 1 || batch < 1 || nThreads < 1
+        || ncols < 1 || nrows < 1 || nMines < 0 || nMines >= ncols * nrows)
+    {
+        usage();
+        return 1;
+    }
+    
+    printf("Up to %d games on %dx%d with %d mines, %d threads\n", maxGames, ncols, nrows, nMines, nThreads);
+    
+    int looks = (maxGames + batch - 1) / batch;
+    double alphaPerLook = alpha / looks;
+    
+    std::vector<std::vector<Result>> results(configs.size(), std::vector<Result>(maxGames));
+    int played = 0;
+    bool significant = false;
+    
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+    size_t poolAllocations = 0;
+    size_t lastPoolAllocations = 0;
+#endif
+    
+    while (played < maxGames && !significant)
+    {
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+        size_t processBefore = processAllocations();
+        size_t mainBefore = threadAllocations();
+        std::atomic<size_t> workerAllocations(0);
+#endif
+        
+        // Every thread plays a game for all configs at once, so
+        // timings are paired as well as wins
+        int end = std::min(played + batch, maxGames);
+        std::atomic<int> next(played);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+        {
+            workers.push_back(std::thread([&] {
+                Solver solver(nullptr, nullptr, 0, 0);
+                int game;
+                while ((game = next++) < end)
+                    for (size_t c = 0; c < configs.size(); c++)
+                        results[c][game] = play(solver, configs[c].options, ncols, nrows, nMines, firstSeed + game);
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+                workerAllocations += threadAllocations();
+#endif
+            }));
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+        played = end;
+        
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+        // Whatever neither this thread nor the game threads allocated
+        lastPoolAllocations = processAllocations() - processBefore - (threadAllocations() - mainBefore) - workerAllocations;
+        poolAllocations += lastPoolAllocations;
+#endif
+        
+        significant = true;
+        printf("%6d games:", played);
+        for (size_t c = 1; c < configs.size(); c++)
+        {
+            int b = 0;
+            int d = 0;
+            for (int g = 0; g < played; g++)
+            {
+                b += results[0][g].won && !results[c][g].won;
+                d += !results[0][g].won && results[c][g].won;
+            }
+            double p = mcnemar(b, d);
+            printf("  p = %.3g", p);
+            if (p >= alphaPerLook)
+                significant = false;
+        }
+        printf("\n");
+    }
+    
+    if (significant)
+        printf("Stopped after %d games: every difference is significant\n", played);
+    
+    printf("\n%-24s %-26s %-16s %-16s %s\n", "config", "win rate", "moves", "guesses", "ms/game");
+    for (size_t c = 0; c < configs.size(); c++)
+    {
+        int wins = 0;
+        std::vector<double> moves, guesses, ms;
+        for (int g = 0; g < played; g++)
+        {
+            wins += results[c][g].won;
+            moves.push_back(results[c][g].moves);
+            guesses.push_back(results[c][g].guesses);
+            ms.push_back(results[c][g].seconds * 1000);
+        }
+        
+        double low, high, mean, half;
+        wilson(wins, played, low, high);
+        printf("%-24s %5.1f%% [%5.1f%%, %5.1f%%]   ", configs[c].name.c_str(),
+               100.0 * wins / played, 100 * low, 100 * high);
+        meanInterval(moves, mean, half);
+        printf("%6.1f +- %-6.2f ", mean, half);
+        meanInterval(guesses, mean, half);
+        printf("%6.2f +- %-6.2f ", mean, half);
+        meanInterval(ms, mean, half);
+        printf("%7.3f +- %.3f\n", mean, half);
+    }
+    
+#ifdef MINESWEEPER_COUNT_ALLOCATIONS
+    int lastBatch = played - std::min(batch, played);
+    printf("\n%-24s %-26s %s\n", "config", "allocations/move", "last batch");
+    for (size_t c = 0; c < configs.size(); c++)
+    {
+        double allocations[2] = {0, 0};
+        double moves[2] = {0, 0};
+        for (int g = 0; g < played; g++)
+        {
+            for (int last = 0; last < 2; last++)
+            {
+                if (last && g < lastBatch)
+                    continue;
+                allocations[last] += results[c][g].allocations;
+                moves[last] += results[c][g].moves;
+            }
+        }
+        printf("%-24s %-26.3f %.3f\n", configs[c].name.c_str(),
+               allocations[0] / std::max(1.0, moves[0]), allocations[1] / std::max(1.0, moves[1]));
+    }
+    
+    double moves[2] = {0, 0};
+    for (size_t c = 0; c < configs.size(); c++)
+        for (int g = 0; g < played; g++)
+            for (int last = 0; last < 2; last++)
+                if (!last || g >= lastBatch)
+                    moves[last] += results[c][g].moves;
+    printf("%-24s %-26.3f %.3f\n", "pool threads",
+           poolAllocations / std::max(1.0, moves[0]), lastPoolAllocations / std::max(1.0, moves[1]));
+#endif
+    
+    printf("\n");
+    for (size_t c = 1; c < configs.size(); c++)
+    {
+        int b = 0;
+        int d = 0;
+        std::vector<double> difference;
+        for (int g = 0; g < played; g++)
+        {
+            b += results[0][g].won && !results[c][g].won;
+            d += !results[0][g].won && results[c][g].won;
+            difference.push_back((double)results[c][g].won - results[0][g].won);
+        }
+        
+        double mean, half;
+        meanInterval(difference, mean, half);
+        double p = mcnemar(b, d);
+        printf("%s vs %s: win rate %+.1f%% [%+.1f%%, %+.1f%%], won only by %s: %d, only by %s: %d, p = %.3g%s\n",
+               configs[c].name.c_str(), configs[0].name.c_str(),
+               100 * mean, 100 * (mean - half), 100 * (mean + half),
+               configs[0].name.c_str(), b, configs[c].name.c_str(), d, p,
+               p < alphaPerLook ? " (significant)" : "");
+    }
+    
+    return 0;
+}
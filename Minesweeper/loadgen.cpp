@@ -0,0 +1,266 @@
+// Load generator for solverd. Plays games with the solver to get realistic
+// positions, then has every connection send its share of them, keeping up to
+// depth requests in flight at once, and reports throughput and latency.
+// Depth 1 waits for each reply before sending the next request.
+//
+// loadgen [-socket PATH] [-connections N] [-requests N] [-depth N]
+//         [-seed N] [-board COLS ROWS MINES]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "game.hpp"
+#include "protocol.hpp"
+#include "solver.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Stats
+{
+    int replies = 0;
+    int errors = 0;
+    std::vector<double> latencies;
+};
+
+// Positions from partway through games, so that there is a mix of
+// early, middle and late positions
+static std::vector<std::string> makePositions(int count, int ncols, int nrows, int nMines, unsigned int seed)
+{
+    std::vector<std::string> positions;
+    std::mt19937 rng(seed);
+    SolverOptions options;
+    options.verbose = false;
+    
+    while ((int)positions.size() < count)
+    {
+        Game game(ncols, nrows, nMines);
+        game.reset(rng());
+        Solver solver(game.board.data(), game.cellState.data(), ncols, nrows, nMines);
+        solver.setOptions(options);
+        solver.seed(rng());
+        game.reveal(rng() % game.size);
+        
+        int stopAt = rng() % game.size;
+        for (int moves = 0; moves < stopAt && !game.won() && !game.lost(); moves++)
+        {
+            int loc = solver.singleSquare();
+            if (loc == -1)
+                loc = solver.multiSquare();
+            if (loc == -1)
+                break;
+            if (loc >= game.size)
+                game.toggleFlag(loc - game.size);
+            else
+                game.reveal(loc);
+        }
+        
+        if (!game.lost())
+            positions.push_back(encodePosition((long)positions.size(), ncols, nrows, nMines,
+                                               game.board.data(), game.cellState.data()));
+    }
+    return positions;
+}
+
+static int connectTo(const std::string &path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends positions first ... last - 1 on one connection
+static void run(const std::string &path, const std::vector<std::string> &positions, int first, int last,
+                int depth, Stats &stats)
+{
+    int fd = connectTo(path);
+    if (fd < 0)
+    {
+        printf("Can't connect to %s: %s\n", path.c_str(), strerror(errno));
+        stats.errors += last - first;
+        return;
+    }
+    
+    std::mutex lock;
+    std::condition_variable space;
+    int inFlight = 0;
+    std::vector<Clock::time_point> sent(positions.size());
+    
+    // Replies are read on their own thread so sending never waits on them
+    std::thread reader([&] {
+        std::vector<char> buffer(1 << 16);
+        std::string line;
+        int received = 0;
+        while (received < last - first)
+        {
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            
+            for (ssize_t i = 0; i < n; i++)
+            {
+                if (buffer[i] != '\n')
+                {
+                    line += buffer[i];
+                    continue;
+                }
+                
+                std::lock_guard<std::mutex> guard(lock);
+                long id;
+                bool ok;
+                if (decodeReplyHeader(line, id, ok) && id >= first && id < last)
+                    stats.latencies.push_back(std::chrono::duration<double>(Clock::now() - sent[id]).count());
+                else
+                    ok = false;
+                stats.replies++;
+                stats.errors += !ok;
+                received++;
+                line.clear();
+                inFlight--;
+                space.notify_one();
+            }
+        }
+        stats.errors += last - first - received;
+    });
+    
+    for (int i = first; i < last; i++)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            space.wait(guard, [&] { return inFlight < depth; });
+            inFlight++;
+            sent[i] = Clock::now();
+        }
+        
+        const std::string &request = positions[i];
+        size_t written = 0;
+        while (written < request.size())
+        {
+            ssize_t n = write(fd, request.data() + written, request.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            written += n;
+        }
+        if (written < request.size())
+            break;
+    }
+    
+    shutdown(fd, SHUT_WR);
+    reader.join();
+    close(fd);
+}
+
+int main(int argc, char *args[])
+{
+    std::string path = "/tmp/minesweeper.sock";
+    int nConnections = 4;
+    int nRequests = 10000;
+    int depth = 16;
+    unsigned int seed = 1;
+    int ncols = 30;
+    int nrows = 16;
+    int nMines = 99;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(args[i], "-socket") && i + 1 < argc)
+            path = args[++i];
+        else if (!strcmp(args[i], "-connections") && i + 1 < argc)
+            nConnections = atoi(args[++i]);
+        else if (!strcmp(args[i], "-requests") && i + 1 < argc)
+            nRequests = atoi(args[++i]);
+        else if (!strcmp(args[i], "-depth") && i + 1 < argc)
+            depth = atoi(args[++i]);
+        else if (!strcmp(args[i], "-seed") && i + 1 < argc)
+            seed = (unsigned int)strtoul(args[++i], nullptr, 10);
+        else if (!strcmp(args[i], "-board") && i + 3 < argc)
+        {
+            ncols = atoi(args[++i]);
+            nrows = atoi(args[++i]);
+            nMines = atoi(args[++i]);
+        }
+        else
+        {
+            printf("Usage: loadgen [-socket PATH] [-connections N] [-requests N] [-depth N]\n"
+                   "               [-seed N] [-board COLS ROWS MINES]\n");
+            return 1;
+        }
+    }
+    
+    if (nConnections < 1 || nRequests < nConnections || depth < 1
+        || ncols < 1 || nrows < 1 || nMines < 0 || nMines >= ncols * nrows)
+    {
+        printf("Bad arguments\n");
+        return 1;
+    }
+    
+    // Fewer distinct positions than requests is fine, they are reused
+    int nPositions = std::min(nRequests, 2000);
+    std::vector<std::string> distinct = makePositions(nPositions, ncols, nrows, nMines, seed);
+    std::vector<std::string> positions;
+    for (int i = 0; i < nRequests; i++)
+    {
+        const std::string &p = distinct[i % nPositions];
+        // Give every request its own id
+        positions.push_back(std::to_string(i) + p.substr(p.find(' ')));
+    }
+    
+    printf("%d requests on %dx%d with %d mines, %d connections, %d in flight each\n",
+           nRequests, ncols, nrows, nMines, nConnections, depth);
+    
+    std::vector<Stats> stats(nConnections);
+    std::vector<std::thread> clients;
+    auto start = Clock::now();
+    for (int c = 0; c < nConnections; c++)
+    {
+        int first = (int)((long)nRequests * c / nConnections);
+        int last = (int)((long)nRequests * (c + 1) / nConnections);
+        clients.push_back(std::thread(run, path, std::cref(positions), first, last, depth, std::ref(stats[c])));
+    }
+    for (std::thread &client : clients)
+        client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    int replies = 0;
+    int errors = 0;
+    std::vector<double> latencies;
+    for (const Stats &s : stats)
+    {
+        replies += s.replies;
+        errors += s.errors;
+        latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    
+    printf("%d replies, %d errors in %.2f s: %.0f requests/s\n", replies, errors, seconds, replies / seconds);
+    if (!latencies.empty())
+    {
+        auto percentile = [&](double q) { return 1000 * latencies[(size_t)(q * (latencies.size() - 1))]; };
+        printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+               percentile(0.5), percentile(0.9), percentile(0.99), percentile(1));
+    }
+    
+    return errors ? 1 : 0;
+}
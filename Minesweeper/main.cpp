@@ -1,65 +1,15 @@
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
 #include "graphics.hpp"
 #include "shared.hpp"
 #include "solver.hpp"
+#include "game.hpp"
+#include "chunkboard.hpp"
 
-// Counts number of mines. If 9, then it is a mine
-int board[BOARDSIZE];
-
-// cellState[loc] = 0 means unrevealed
-// cellState[loc] = 1 means revealed
-// cellState[loc] = 2 means flagged
-unsigned int cellState[BOARDSIZE];
-
-static int countAdjacentMines(int loc)
-{
-    int count = 0;
-    for (const auto &rp : relPos)
-    {
-        int row = loc / NCOLS;
-        int col = loc % NCOLS;
-        
-        row += rp.y;
-        col += rp.x;
-        
-        if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS)
-            if (board[(row * NCOLS) + col] == 9)
-                count++;
-    }
-    
-    return count;
-}
-
-static void placeMines(int firstTile)
-{
-    int mineLocations[BOARDSIZE];
-    
-    // Reset to empty board
-    for (int &cell : board)
-        cell = -1;
-    
-    for (int i = 0; i < firstTile; i++)
-        mineLocations[i] = i;
-    
-    for (int i = firstTile + 1; i < BOARDSIZE; i++)
-        mineLocations[i - 1] = i;
-    
-    for (int i = 0; i < NMINES; i++)
-    {
-        int n = rand() % ((BOARDSIZE - 1) - i);
-        
-        board[mineLocations[n]] = 9;
-        
-        mineLocations[n] = mineLocations[(BOARDSIZE - 2) - i];
-    }
-    
-    // Fill in the rest of the board accordingly
-    for (int i = 0; i < BOARDSIZE; i++)
-        if (board[i] != 9)
-            board[i] = countAdjacentMines(i);
-}
+// Chunks of the infinite board whose numbers stay cached
+const size_t MAX_CACHED_CHUNKS = 64;
 
 static int getTileNum(int x, int y)
 {
@@ -72,48 +22,8 @@ static int getTileNum(int x, int y)
     
 }
 
-static int floodFill(int loc, int *queue)
-{
-    bool visited[BOARDSIZE] = {};
-    int left = 0;
-    int right = 0;
-    
-    queue[right++] = loc;
-    visited[loc] = true;
-    
-    while (left < right)
-    {
-        int curLoc = queue[left++];
-        if (board[curLoc] == 0)
-        {
-            for (const auto &rp : relPos)
-            {
-                int row = curLoc / NCOLS;
-                int col = curLoc % NCOLS;
-                
-                row += rp.y;
-                col += rp.x;
-                
-                if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS)
-                {
-                    int newLoc = (row * NCOLS) + col;
-                    
-                    if (!visited[newLoc] && cellState[newLoc] != REVEALED)
-                    {
-                        queue[right++] = newLoc;
-                        visited[newLoc] = true;
-                    }
-                }
-            }
-        }
-    }
-    
-    return right;
-}
-
 int main(int argc, char* args[])
 {
-    srand((unsigned int)time(NULL));
     bool firstClick = true;
     int firstClickTicks = 0;
     bool doingReveal = false;
@@ -126,9 +36,27 @@ int main(int argc, char* args[])
     int secs = 0;
     int unrevealedCount = BOARDSIZE;
     TextureStruct textures;
-    Solver solver;
+    Game game(NCOLS, NROWS, NMINES);
+    Solver solver(game.board.data(), game.cellState.data(), NCOLS, NROWS, NMINES);
     Texture *currentFace = &(textures.happy);
     
+    // Infinite mode plays on a ChunkBoard instead. The screen shows the window
+    // with top left corner viewX, viewY, and the solver gets that window
+    // grown by one tile on each side, so nothing on screen is clipped.
+    bool infinite = argc > 1 && strcmp(args[1], "-infinite") == 0;
+    ChunkBoard chunkBoard((uint64_t)time(NULL), (double)NMINES / BOARDSIZE);
+    int viewX = -NCOLS / 2;
+    int viewY = -NROWS / 2;
+    int windowBoard[(NCOLS + 2) * (NROWS + 2)];
+    unsigned int windowState[(NCOLS + 2) * (NROWS + 2)];
+    game.reset((unsigned int)time(NULL));
+    solver.seed((unsigned int)time(NULL));
+    if (infinite)
+    {
+        solver.setBoard(windowBoard, windowState, NCOLS + 2, NROWS + 2);
+        solver.setDensity((double)NMINES / BOARDSIZE);
+    }
+    
     if(!init())
     {
         printf("Failed to initialize!\n");
@@ -143,6 +71,14 @@ int main(int argc, char* args[])
         {
             bool quit = false;
             
+            // The infinite board always starts with the origin open
+            if (infinite)
+            {
+                chunkBoard.reveal(0, 0);
+                firstClick = false;
+                firstClickTicks = SDL_GetTicks();
+            }
+            
             SDL_Event e;
             
             while(!quit)
@@ -153,11 +89,27 @@ int main(int argc, char* args[])
                     {
                         quit = true;
                     }
+                    else if (e.type == SDL_KEYDOWN && infinite)
+                    {
+                        // Arrow keys scroll around the infinite board
+                        if (e.key.keysym.sym == SDLK_LEFT)
+                            viewX--;
+                        else if (e.key.keysym.sym == SDLK_RIGHT)
+                            viewX++;
+                        else if (e.key.keysym.sym == SDLK_UP)
+                            viewY--;
+                        else if (e.key.keysym.sym == SDLK_DOWN)
+                            viewY++;
+                        
+                        // Queued moves are relative to the old window
+                        solver.clearQueue();
+                    }
                     else if (e.type == SDL_MOUSEBUTTONDOWN && !doingReveal)
                     {
                         // tileNum returns -1 if clicking on top bar.
                         // solver will change tileNum if it moves.
                         int tileNum = getTileNum(e.button.x, e.button.y);
+                        bool fromSolver = false;
                         
                         if (tileNum == -1)
                         {
@@ -174,11 +126,19 @@ int main(int argc, char* args[])
                                 nFlags = 0;
                                 solver.clearQueue();
                                 
-                                // Set all tiles to unrevealed/unflagged.
-                                for (unsigned int &cell : cellState)
-                                    cell = 0;
+                                game.reset((unsigned int)time(NULL));
                                 
                                 unrevealedCount = BOARDSIZE;
+                                
+                                if (infinite)
+                                {
+                                    chunkBoard.reset((uint64_t)time(NULL));
+                                    chunkBoard.reveal(0, 0);
+                                    viewX = -NCOLS / 2;
+                                    viewY = -NROWS / 2;
+                                    firstClick = false;
+                                    firstClickTicks = SDL_GetTicks();
+                                }
                                 continue;
                             }
                             // Click on light bulb
@@ -186,8 +146,13 @@ int main(int argc, char* args[])
                                      && e.button.x > SCREEN_WIDTH / 2 + 15
                                      && e.button.x < SCREEN_WIDTH / 2 + 45)
                             {
+                                if (infinite)
+                                    chunkBoard.exportWindow(viewX - 1, viewY - 1, NCOLS + 2, NROWS + 2,
+                                                            windowBoard, windowState, true);
+                                
                                 // solver.singleSquare() returns an idx to move, or if it's a flag
                                 // it returns idx + BOARDSIZE
+                                fromSolver = true;
                                 tileNum = solver.singleSquare();
                                 if (tileNum == -1)
                                 {
@@ -197,30 +162,66 @@ int main(int argc, char* args[])
                             }
                         }
                         
+                        if (infinite)
+                        {
+                            if (tileNum == -1 || gameOver)
+                                continue;
+                            
+                            // Find the tile on the infinite board
+                            bool flag = e.button.button == SDL_BUTTON_RIGHT;
+                            int x, y;
+                            if (fromSolver)
+                            {
+                                int windowSize = (NCOLS + 2) * (NROWS + 2);
+                                flag = tileNum >= windowSize;
+                                tileNum %= windowSize;
+                                x = viewX - 1 + tileNum % (NCOLS + 2);
+                                y = viewY - 1 + tileNum / (NCOLS + 2);
+                            }
+                            else
+                            {
+                                x = viewX + tileNum % NCOLS;
+                                y = viewY + tileNum / NCOLS;
+                            }
+                            
+                            if (flag)
+                            {
+                                chunkBoard.toggleFlag(x, y);
+                            }
+                            else if (chunkBoard.state(x, y) == 0 && chunkBoard.reveal(x, y) == -1)
+                            {
+                                currentFace = &(textures.dead);
+                                gameOver = true;
+                            }
+                            
+                            chunkBoard.evictCold(MAX_CACHED_CHUNKS);
+                            continue;
+                        }
+                        
                         if (tileNum != -1
                             && tileNum < BOARDSIZE
                             && e.button.button == SDL_BUTTON_LEFT
-                            && cellState[tileNum] == 0
+                            && game.cellState[tileNum] == 0
                             && !gameOver)
                         {
                             if (firstClick)
                             {
-                                placeMines(tileNum);
+                                game.placeMines(tileNum);
                                 firstClick = false;
                                 firstClickTicks = SDL_GetTicks();
                             }
                             
                             // Click on a mine
-                            if (board[tileNum] == 9)
+                            if (game.board[tileNum] == 9)
                             {
                                 currentFace = &(textures.dead);
                                 for (int i = 0; i < BOARDSIZE; i++)
-                                    if (!(cellState[i] & FLAGGED))
-                                        cellState[i] = REVEALED;
+                                    if (!(game.cellState[i] & FLAGGED))
+                                        game.cellState[i] = REVEALED;
                                 gameOver = true;
                             }
                             
-                            revealCount = floodFill(tileNum, floodFillQueue);
+                            revealCount = game.floodFill(tileNum, floodFillQueue);
                             unrevealedCount -= revealCount;
                             if (unrevealedCount == NMINES)
                             {
@@ -233,18 +234,18 @@ int main(int argc, char* args[])
                         }
                         else if (tileNum >= BOARDSIZE ||
                                  (e.button.button == SDL_BUTTON_RIGHT
-                                  && !(cellState[tileNum] & REVEALED)
+                                  && !(game.cellState[tileNum] & REVEALED)
                                   && !gameOver))
                         {
                             if (tileNum >= BOARDSIZE)
                                 tileNum -= BOARDSIZE;
                             
-                            if (cellState[tileNum] & FLAGGED)
+                            if (game.cellState[tileNum] & FLAGGED)
                                 nFlags--;
                             else
                                 nFlags++;
                             
-                            cellState[tileNum] ^= FLAGGED;
+                            game.cellState[tileNum] ^= FLAGGED;
                         }
                     }
                 }
@@ -258,10 +259,10 @@ int main(int argc, char* args[])
                         int idx = floodFillQueue[revealIndex];
                         lastRevealTicks = curTicks;
                         
-                        if (cellState[idx] & FLAGGED)
+                        if (game.cellState[idx] & FLAGGED)
                             nFlags--;
                         
-                        cellState[idx] = REVEALED;
+                        game.cellState[idx] = REVEALED;
                         
                         if (++revealIndex == revealCount)
                             doingReveal = false;
@@ -279,6 +280,14 @@ int main(int argc, char* args[])
                         secs = 999;
                 }
                 
+                // Infinite mode shows the part of the infinite board on screen
+                if (infinite)
+                {
+                    chunkBoard.exportWindow(viewX, viewY, NCOLS, NROWS,
+                                            game.board.data(), game.cellState.data(), false);
+                    nFlags = chunkBoard.flags();
+                }
+                
                 // Display timer
                 textures.counterNumbers[secs / 100].render(0, 0);
                 textures.counterNumbers[(secs / 10) % 10].render(30, 0);
@@ -287,24 +296,26 @@ int main(int argc, char* args[])
                 currentFace->render(SCREEN_WIDTH / 2 - 15, 0);
                 textures.lightBulb.render(SCREEN_WIDTH / 2 + 15, -3);
                 
-                // Display supposed number of remaining mines
+                // Display supposed number of remaining mines,
+                // or the number of flags on the infinite board
                 int a = nFlags > NMINES ? NMINES : nFlags;
-                textures.counterNumbers[(NMINES - a) / 100].render(SCREEN_WIDTH - 90, 0);
-                textures.counterNumbers[(NMINES - a) / 10].render(SCREEN_WIDTH - 60, 0);
-                textures.counterNumbers[(NMINES - a) % 10].render(SCREEN_WIDTH - 30, 0);
+                int counter = infinite ? (nFlags > 999 ? 999 : nFlags) : NMINES - a;
+                textures.counterNumbers[counter / 100].render(SCREEN_WIDTH - 90, 0);
+                textures.counterNumbers[(counter / 10) % 10].render(SCREEN_WIDTH - 60, 0);
+                textures.counterNumbers[counter % 10].render(SCREEN_WIDTH - 30, 0);
                 
                 for (int i = 0; i < BOARDSIZE; i++)
                 {
                     int x = TILE_WIDTH * (i % NCOLS);
                     int y = 50 + TILE_HEIGHT * (i / NCOLS);
                     
-                    if (cellState[i] & FLAGGED)
+                    if (game.cellState[i] & FLAGGED)
                     {
                         textures.flag.render(x, y);
                     }
-                    else if (cellState[i] & REVEALED)
+                    else if (game.cellState[i] & REVEALED)
                     {
-                        int n = board[i];
+                        int n = game.board[i];
                         if (n == 9)
                             textures.mine.render(x, y);
                         else if (n > 0)
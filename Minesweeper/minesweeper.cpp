@@ -0,0 +1,213 @@
+#include <new>
+#include "minesweeper.hpp"
+#include "game.hpp"
+#include "solver.hpp"
+#include "shared.hpp"
+
+struct MinesweeperBoard::Impl
+{
+    Impl(int ncols, int nrows, int nMines)
+        : game(ncols, nrows, nMines),
+          solver(game.board.data(), game.cellState.data(), ncols, nrows, nMines)
+    {
+        SolverOptions options;
+        options.verbose = false;
+        solver.setOptions(options);
+        position = false;
+        analysed = false;
+    }
+    
+    Game game;
+    Solver solver;
+    // Set up with setTile, so there are no mines to reveal
+    bool position;
+    // Whether the solver's probabilities are up to date
+    bool analysed;
+    
+    int loc(int col, int row)
+    {
+        return row * game.ncols + col;
+    }
+    
+    bool onBoard(int col, int row)
+    {
+        return col >= 0 && col < game.ncols && row >= 0 && row < game.nrows;
+    }
+    
+    MinesweeperMove move(int loc)
+    {
+        MinesweeperMove move;
+        move.flag = loc >= game.size;
+        if (move.flag)
+            loc -= game.size;
+        move.col = loc % game.ncols;
+        move.row = loc / game.ncols;
+        return move;
+    }
+};
+
+MinesweeperBoard::MinesweeperBoard(int ncols, int nrows, int nMines)
+{
+    // Every call checks impl, so a board that can't be made just fails
+    impl = nullptr;
+    if (ncols < 1 || nrows < 1 || ncols > MINESWEEPER_MAX_TILES / nrows)
+        return;
+    if (nMines < 0 || nMines >= ncols * nrows)
+        return;
+    
+    try
+    {
+        impl = new Impl(ncols, nrows, nMines);
+    }
+    catch (const std::bad_alloc &)
+    {
+        impl = nullptr;
+    }
+}
+
+MinesweeperBoard::~MinesweeperBoard()
+{
+    delete impl;
+}
+
+bool MinesweeperBoard::valid() const
+{
+    return impl != nullptr;
+}
+
+int MinesweeperBoard::columns() const
+{
+    return impl ? impl->game.ncols : 0;
+}
+
+int MinesweeperBoard::rows() const
+{
+    return impl ? impl->game.nrows : 0;
+}
+
+int MinesweeperBoard::mines() const
+{
+    return impl ? impl->game.nMines : 0;
+}
+
+void MinesweeperBoard::newGame(unsigned int seed)
+{
+    if (!impl)
+        return;
+    
+    impl->game.reset(seed);
+    impl->solver.seed(seed);
+    impl->solver.clearQueue();
+    impl->position = false;
+    impl->analysed = false;
+}
+
+int MinesweeperBoard::reveal(int col, int row)
+{
+    if (!impl || !impl->onBoard(col, row))
+        return MINESWEEPER_OFF_BOARD;
+    if (impl->position)
+        return -2;
+    
+    impl->analysed = false;
+    return impl->game.reveal(impl->loc(col, row));
+}
+
+void MinesweeperBoard::toggleFlag(int col, int row)
+{
+    if (!impl || !impl->onBoard(col, row))
+        return;
+    
+    impl->game.toggleFlag(impl->loc(col, row));
+    impl->analysed = false;
+}
+
+bool MinesweeperBoard::won() const
+{
+    return impl && !impl->position && impl->game.won();
+}
+
+bool MinesweeperBoard::lost() const
+{
+    return impl && !impl->position && impl->game.lost();
+}
+
+void MinesweeperBoard::setTile(int col, int row, int tile)
+{
+    if (!impl || !impl->onBoard(col, row) || tile < MINESWEEPER_FLAG || tile > 9)
+        return;
+    
+    int loc = impl->loc(col, row);
+    
+    // Anything known from before may not hold any more
+    impl->solver.clearQueue();
+    impl->position = true;
+    impl->analysed = false;
+    
+    if (tile == MINESWEEPER_UNREVEALED)
+    {
+        impl->game.cellState[loc] = 0;
+        impl->game.board[loc] = -1;
+    }
+    else if (tile == MINESWEEPER_FLAG)
+    {
+        impl->game.cellState[loc] = FLAGGED;
+        impl->game.board[loc] = -1;
+    }
+    else
+    {
+        impl->game.cellState[loc] = REVEALED;
+        impl->game.board[loc] = tile;
+    }
+}
+
+int MinesweeperBoard::tile(int col, int row) const
+{
+    if (!impl || !impl->onBoard(col, row))
+        return MINESWEEPER_OFF_BOARD;
+    
+    int loc = impl->loc(col, row);
+    
+    if (impl->game.cellState[loc] & REVEALED)
+        return impl->game.board[loc];
+    if (impl->game.cellState[loc] & FLAGGED)
+        return MINESWEEPER_FLAG;
+    return MINESWEEPER_UNREVEALED;
+}
+
+std::vector<MinesweeperMove> MinesweeperBoard::certainMoves()
+{
+    std::vector<MinesweeperMove> certain;
+    if (!impl)
+        return certain;
+    
+    for (const int &loc : impl->solver.certainMoves())
+        certain.push_back(impl->move(loc));
+    impl->analysed = true;
+    return certain;
+}
+
+double MinesweeperBoard::mineProbability(int col, int row)
+{
+    if (!impl || !impl->onBoard(col, row))
+        return -1;
+    if (!impl->analysed)
+        certainMoves();
+    
+    return impl->solver.probability(impl->loc(col, row));
+}
+
+bool MinesweeperBoard::suggestMove(MinesweeperMove &move)
+{
+    if (!impl)
+        return false;
+    
+    int loc = impl->solver.singleSquare();
+    if (loc == -1)
+        loc = impl->solver.multiSquare();
+    if (loc == -1)
+        return false;
+    
+    move = impl->move(loc);
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef minesweeper_hpp
+#define minesweeper_hpp
+
+#include <vector>
+
+// Public interface of the minesweeper library. It only exposes these types,
+// so the game and solver behind them can change without breaking programs
+// that link against the library. Bumped whenever this header changes in a
+// way that isn't backwards compatible.
+#define MINESWEEPER_API_VERSION 1
+
+// What tile() returns and setTile() takes, besides 0 - 8 for a revealed
+// number and 9 for a revealed mine
+const int MINESWEEPER_UNREVEALED = -1;
+const int MINESWEEPER_FLAG = -2;
+// What tile() and reveal() return for a tile off the board, or if the board isn't valid
+const int MINESWEEPER_OFF_BOARD = -3;
+// Most tiles a board can have, e.g. 2048 x 2048. The solver needs memory for
+// every tile, so a board much bigger would take more than most hosts have.
+const int MINESWEEPER_MAX_TILES = 1 << 22;
+
+struct MinesweeperMove
+{
+    int col;
+    int row;
+    bool flag;  // Flag the tile instead of revealing it
+};
+
+// A board, either a game being played with mines placed from a seed, or a
+// position set up tile by tile with nothing known about the mines but their
+// total, plus a solver that analyses it. Boards are independent of each
+// other, so different threads can use different boards at the same time.
+//
+// Nothing a caller passes in can crash a board. Calls about a tile off the
+// board fail as described below, and so does every call on a board that
+// isn't valid.
+class MinesweeperBoard
+{
+public:
+    MinesweeperBoard(int ncols, int nrows, int nMines);
+    ~MinesweeperBoard();
+    MinesweeperBoard(const MinesweeperBoard &) = delete;
+    MinesweeperBoard &operator=(const MinesweeperBoard &) = delete;
+    
+    // False if the board couldn't be made, because ncols or nrows is less
+    // than 1, there are more than MINESWEEPER_MAX_TILES tiles, nMines is
+    // negative or leaves no tile free for the first reveal, or there wasn't
+    // enough memory
+    bool valid() const;
+    // All 0 if the board isn't valid
+    int columns() const;
+    int rows() const;
+    int mines() const;
+    
+    // Starts a new game. Mines are placed from seed on the first reveal,
+    // so that the first tile revealed is never a mine.
+    void newGame(unsigned int seed);
+    // Returns the number of tiles revealed, -1 if the tile is a mine,
+    // -2 if the board is a position set up with setTile, or
+    // MINESWEEPER_OFF_BOARD.
+    int reveal(int col, int row);
+    // Does nothing off the board
+    void toggleFlag(int col, int row);
+    bool won() const;
+    bool lost() const;
+    
+    // Sets up a position one tile at a time, e.g. from another program's game.
+    // Does nothing off the board or if tile isn't one tile() could return.
+    void setTile(int col, int row, int tile);
+    int tile(int col, int row) const;
+    
+    // Every move that is certain to be right, none if the board isn't valid
+    std::vector<MinesweeperMove> certainMoves();
+    // Chance of a mine at an unrevealed tile, or -1 if it isn't known or is off the board
+    double mineProbability(int col, int row);
+    // A certain move if there is one, otherwise the best guess.
+    // Returns false if there are no unrevealed tiles left or the board isn't valid.
+    bool suggestMove(MinesweeperMove &move);
+    
+private:
+    struct Impl;
+    Impl *impl;
+};
+
+#endif /* minesweeper_hpp */
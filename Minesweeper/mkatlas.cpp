@@ -0,0 +1,168 @@
+// Packs images into one atlas at build time, and writes it out as a source
+// file that compiles the atlas PNG and where each image is into the program.
+//
+// mkatlas OUTPUT.cpp image.png ...
+//
+// Images are named by their file name without .png. Cyan is transparent, as
+// for Texture::loadFromFile, so the atlas has an alpha channel instead. The
+// atlas PNG is also left next to the output as OUTPUT.png, to look at.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <SDL2/SDL.h>
+#ifdef __APPLE__
+#include <SDL2_image/SDL_image.h>
+#else
+#include <SDL2/SDL_image.h>
+#endif
+
+// Shelves are at most this wide
+const int MAX_WIDTH = 512;
+// Space around every image, so that filtering never picks up a neighbour
+const int PADDING = 1;
+
+struct Image
+{
+    std::string name;
+    SDL_Surface *surface;
+    SDL_Rect rect;
+};
+
+static std::string imageName(const std::string &path)
+{
+    size_t start = path.find_last_of("/\\");
+    start = start == std::string::npos ? 0 : start + 1;
+    size_t end = path.rfind(".png");
+    if (end == std::string::npos || end < start)
+        end = path.size();
+    return path.substr(start, end - start);
+}
+
+// Puts images in rows, tallest first, and returns the size of the atlas
+static void pack(std::vector<Image> &images, int &width, int &height)
+{
+    std::sort(images.begin(), images.end(), [](const Image &a, const Image &b) {
+        if (a.surface->h != b.surface->h)
+            return a.surface->h > b.surface->h;
+        return a.name < b.name;
+    });
+    
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    width = 0;
+    for (Image &image : images)
+    {
+        if (x > 0 && x + image.surface->w + PADDING > MAX_WIDTH)
+        {
+            x = 0;
+            y += shelfHeight + PADDING;
+            shelfHeight = 0;
+        }
+        
+        image.rect = {x, y, image.surface->w, image.surface->h};
+        x += image.surface->w + PADDING;
+        shelfHeight = std::max(shelfHeight, image.surface->h);
+        width = std::max(width, x);
+    }
+    height = y + shelfHeight;
+}
+
+static bool writeSource(const std::string &path, const std::vector<unsigned char> &png,
+                        const std::vector<Image> &images)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Unable to write %s!\n", path.c_str());
+        return false;
+    }
+    
+    fprintf(file, "// Generated by mkatlas. Don't edit.\n\n#include \"atlas.hpp\"\n\n");
+    fprintf(file, "const unsigned char atlasPNG[] = {");
+    for (size_t i = 0; i < png.size(); i++)
+        fprintf(file, "%s0x%02x,", i % 16 ? " " : "\n    ", png[i]);
+    fprintf(file, "\n};\n\nconst int atlasPNGSize = %d;\n\n", (int)png.size());
+    
+    fprintf(file, "const AtlasImage atlasImages[] = {\n");
+    for (const Image &image : images)
+        fprintf(file, "    {\"%s\", {%d, %d, %d, %d}},\n", image.name.c_str(),
+                image.rect.x, image.rect.y, image.rect.w, image.rect.h);
+    fprintf(file, "};\n\nconst int atlasImageCount = %d;\n", (int)images.size());
+    
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+int main(int argc, char *args[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: mkatlas OUTPUT.cpp image.png ...\n");
+        return 1;
+    }
+    
+    std::vector<Image> images;
+    for (int i = 2; i < argc; i++)
+    {
+        Image image;
+        image.name = imageName(args[i]);
+        image.surface = IMG_Load(args[i]);
+        if (image.surface == nullptr)
+        {
+            printf("Unable to load image %s! SDL_image Error: %s\n", args[i], IMG_GetError());
+            return 1;
+        }
+        images.push_back(image);
+    }
+    
+    int width, height;
+    pack(images, width, height);
+    
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (atlas == nullptr)
+    {
+        printf("Atlas could not be created! SDL Error: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_FillRect(atlas, nullptr, 0);
+    
+    // Copy alpha as it is, and leave cyan out so it stays transparent
+    for (Image &image : images)
+    {
+        SDL_SetColorKey(image.surface, SDL_TRUE, SDL_MapRGB(image.surface->format, 0, 0xFF, 0xFF));
+        SDL_SetSurfaceBlendMode(image.surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(image.surface, nullptr, atlas, &image.rect);
+        SDL_FreeSurface(image.surface);
+    }
+    
+    std::string output = args[1];
+    std::string pngPath = output + ".png";
+    if (IMG_SavePNG(atlas, pngPath.c_str()) < 0)
+    {
+        printf("Unable to save %s! SDL_image Error: %s\n", pngPath.c_str(), IMG_GetError());
+        return 1;
+    }
+    SDL_FreeSurface(atlas);
+    
+    std::vector<unsigned char> png;
+    FILE *file = fopen(pngPath.c_str(), "rb");
+    if (file == nullptr)
+    {
+        printf("Unable to read %s!\n", pngPath.c_str());
+        return 1;
+    }
+    int c;
+    while ((c = fgetc(file)) != EOF)
+        png.push_back((unsigned char)c);
+    fclose(file);
+    
+    if (!writeSource(output, png, images))
+        return 1;
+    
+    printf("Packed %d images into a %dx%d atlas of %d bytes\n", (int)images.size(), width, height, (int)png.size());
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <cmath>
+#include "options.hpp"
+
+bool parseOptions(const std::string &words, SolverOptions &options)
+{
+    size_t start = 0;
+    while (start <= words.size())
+    {
+        size_t end = words.find(',', start);
+        if (end == std::string::npos)
+            end = words.size();
+        std::string word = words.substr(start, end - start);
+        
+        if (word == "safest")
+            options.guess = GUESS_SAFEST;
+        else if (word == "random")
+            options.guess = GUESS_RANDOM;
+        else if (word == "lookahead")
+            options.guess = GUESS_LOOKAHEAD;
+        else if (word == "ply2")
+            options.lookaheadPly = 2;
+        else if (word == "nostrips")
+            options.useStrips = false;
+        else if (word == "nocount")
+            options.useMineCount = false;
+        else if (word == "sample")
+            options.sampleAbove = 0;
+        else if (word == "nosample")
+            options.sampleAbove = INFINITY;
+        else
+            return false;
+        
+        start = end + 1;
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef options_hpp
+#define options_hpp
+
+#include <string>
+#include "solver.hpp"
+
+// Sets options from a comma separated list of words, e.g. "safest,nostrips",
+// so that tools can name the same solver configurations:
+//   safest    guess the tile least likely to be a mine
+//   random    guess any unrevealed tile
+//   lookahead guess the safe-looking tile most likely to lead to another safe move (default)
+//   ply2      look two moves ahead instead of one
+//   nostrips  always search instead of using countStrip
+//   nocount   ignore the number of mines left on the board
+//   sample    sample every component countStrip can't count, instead of searching
+//   nosample  always search, however big the search
+// Returns false if a word isn't one of these.
+bool parseOptions(const std::string &words, SolverOptions &options);
+
+#endif /* options_hpp */
@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "protocol.hpp"
+#include "shared.hpp"
+
+std::string encodePosition(long id, int ncols, int nrows, int nMines,
+                           const int *board, const unsigned int *cellState)
+{
+    char header[64];
+    snprintf(header, sizeof(header), "%ld %d %d %d ", id, ncols, nrows, nMines);
+    
+    std::string line = header;
+    for (int loc = 0; loc < ncols * nrows; loc++)
+    {
+        if (cellState[loc] & REVEALED)
+            line += (char)('0' + board[loc]);
+        else if (cellState[loc] & FLAGGED)
+            line += 'F';
+        else
+            line += '.';
+    }
+    line += '\n';
+    return line;
+}
+
+bool decodePosition(const std::string &line, Position &position, std::string &error)
+{
+    position.id = -1;
+    
+    int tilesStart = 0;
+    if (sscanf(line.c_str(), "%ld %d %d %d %n", &position.id, &position.ncols, &position.nrows,
+               &position.nMines, &tilesStart) < 4 || tilesStart == 0)
+    {
+        error = "expected <id> <ncols> <nrows> <nMines> <tiles>";
+        return false;
+    }
+    
+    if (position.ncols < 1 || position.nrows < 1 || position.ncols > 1024 || position.nrows > 1024)
+    {
+        error = "bad board size";
+        return false;
+    }
+    
+    int size = position.ncols * position.nrows;
+    if ((int)line.size() - tilesStart != size)
+    {
+        error = "expected ncols * nrows tiles";
+        return false;
+    }
+    if (position.nMines < -1 || position.nMines > size)
+    {
+        error = "bad number of mines";
+        return false;
+    }
+    
+    position.board.assign(size, -1);
+    position.cellState.assign(size, 0);
+    for (int loc = 0; loc < size; loc++)
+    {
+        char c = line[tilesStart + loc];
+        if (c >= '0' && c <= '8')
+        {
+            position.board[loc] = c - '0';
+            position.cellState[loc] = REVEALED;
+        }
+        else if (c == 'F')
+            position.cellState[loc] = FLAGGED;
+        else if (c != '.')
+        {
+            error = "unknown tile ";
+            error += c;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string encodeReply(long id, const std::vector<int> &moves, const std::vector<double> &probabilities)
+{
+    int size = (int)probabilities.size();
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%ld ok %d", id, (int)moves.size());
+    
+    std::string line = buffer;
+    line.reserve(line.size() + moves.size() * 6 + probabilities.size() * 7);
+    for (const int &loc : moves)
+    {
+        snprintf(buffer, sizeof(buffer), loc >= size ? " F%d" : " R%d", loc >= size ? loc - size : loc);
+        line += buffer;
+    }
+    for (const double &p : probabilities)
+    {
+        if (p < 0)
+            line += " -";
+        else
+        {
+            snprintf(buffer, sizeof(buffer), " %.4g", p);
+            line += buffer;
+        }
+    }
+    line += '\n';
+    return line;
+}
+
+std::string encodeError(long id, const std::string &message)
+{
+    char header[32];
+    snprintf(header, sizeof(header), "%ld error ", id);
+    return header + message + '\n';
+}
+
+bool decodeReplyHeader(const std::string &line, long &id, bool &ok)
+{
+    char status[8];
+    if (sscanf(line.c_str(), "%ld %7s", &id, status) != 2)
+        return false;
+    
+    ok = !strcmp(status, "ok");
+    return ok || !strcmp(status, "error");
+}
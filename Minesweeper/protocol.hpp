@@ -0,0 +1,45 @@
+#ifndef protocol_hpp
+#define protocol_hpp
+
+#include <string>
+#include <vector>
+
+// Line based protocol spoken by solverd. Clients may send any number of
+// requests without waiting for replies; replies come back in the order they
+// are solved, which need not be the order they were sent, so each carries
+// the id of its request.
+//
+// Request:  <id> <ncols> <nrows> <nMines> <tiles>
+//   nMines is -1 if it isn't known. tiles has one character per tile, row
+//   by row: '.' unrevealed, 'F' flagged, '0' - '8' a revealed number.
+// Reply:    <id> ok <n> <move> ... <probability> ...
+//   n certain moves, each R<loc> to reveal or F<loc> to flag, where
+//   loc = row * ncols + col, then the chance of a mine at every tile,
+//   or - where there is none.
+// Or:       <id> error <message>
+
+// Longest request accepted, so that a bad client can't use up memory
+const size_t MAX_REQUEST = 1 << 20;
+
+struct Position
+{
+    long id;
+    int ncols;
+    int nrows;
+    int nMines;
+    std::vector<int> board;
+    std::vector<unsigned int> cellState;
+};
+
+std::string encodePosition(long id, int ncols, int nrows, int nMines,
+                           const int *board, const unsigned int *cellState);
+// Returns false, with what is wrong in error, if line isn't a valid request.
+// id is filled in whenever line starts with one.
+bool decodePosition(const std::string &line, Position &position, std::string &error);
+
+std::string encodeReply(long id, const std::vector<int> &moves, const std::vector<double> &probabilities);
+std::string encodeError(long id, const std::string &message);
+// Reads the id and whether the reply is ok, without the rest
+bool decodeReplyHeader(const std::string &line, long &id, bool &ok);
+
+#endif /* protocol_hpp */
@@ -0,0 +1,288 @@
+// Plays games the way harness does and draws every move without a display,
+// for looking at games from a batch run. Frames are written as one PNG per
+// move, or as raw RGB24 video on stdout to pipe into an encoder, e.g.
+//
+//   replay -raw -lost -board 30 16 99 safest | ffmpeg -f rawvideo
+//       -pixel_format rgb24 -video_size 900x530 -framerate 10 -i - lost.mp4
+//
+// replay [-games N] [-seed N] [-board COLS ROWS MINES] [-lost] [-png DIR | -raw] [config]
+//
+// config is a list of solver options as harness takes them. Game n has seed
+// seed + n as in harness, so with the same -seed and config it shows the same
+// games. -lost only draws the games the solver lost. Every game is played
+// once and drawn from the moves it was played with. Messages go to stderr,
+// since stdout may be the video.
+//
+// Only tiles that changed since the last frame are drawn again, and draw calls
+// are batched, so most of the time goes to the solver and to writing frames.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "graphics.hpp"
+#include "shared.hpp"
+#include "game.hpp"
+#include "solver.hpp"
+#include "options.hpp"
+
+// What a tile shows besides 0 - 8 for a number and 9 for a mine
+const int IMAGE_FLAG = 10;
+const int IMAGE_UNREVEALED = 11;
+// Nothing drawn there yet
+const int IMAGE_NONE = -1;
+
+static int tileImage(Game &game, int loc)
+{
+    if (game.cellState[loc] & FLAGGED)
+        return IMAGE_FLAG;
+    if (game.cellState[loc] & REVEALED)
+        return game.board[loc];
+    // Once the game is lost, show where the mines were
+    if (game.lost() && game.board[loc] == 9)
+        return 9;
+    return IMAGE_UNREVEALED;
+}
+
+static void drawCounter(TextureStruct &textures, int value, int x)
+{
+    value = std::max(0, std::min(999, value));
+    textures.counterNumbers[value / 100].render(x, 0);
+    textures.counterNumbers[(value / 10) % 10].render(x + 30, 0);
+    textures.counterNumbers[value % 10].render(x + 60, 0);
+}
+
+// Draws the board into the framebuffer, as the game shows it, with the
+// number of moves in place of the timer. drawn is what each tile showed in
+// the last frame, and only tiles showing something else are drawn again.
+static void drawFrame(TextureStruct &textures, Game &game, int moves, std::vector<int> &drawn)
+{
+    int nFlags = 0;
+    for (int loc = 0; loc < game.size; loc++)
+    {
+        int image = tileImage(game, loc);
+        nFlags += image == IMAGE_FLAG;
+        if (image == drawn[loc])
+            continue;
+        drawn[loc] = image;
+        
+        int x = TILE_WIDTH * (loc % game.ncols);
+        int y = 50 + TILE_HEIGHT * (loc / game.ncols);
+        SDL_Rect tile = {x, y, TILE_WIDTH, TILE_HEIGHT};
+        SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+        SDL_RenderFillRect(renderer, &tile);
+        
+        if (image == IMAGE_FLAG)
+            textures.flag.render(x, y);
+        else if (image == IMAGE_UNREVEALED)
+            textures.unrevealed.render(x, y);
+        else if (image == 9)
+            textures.mine.render(x, y);
+        else if (image > 0)
+            textures.numbers[image - 1].render(x, y);
+        
+        // The grid lines on this tile's edges
+        SDL_Rect outline = {x, y, TILE_WIDTH + 1, TILE_HEIGHT + 1};
+        SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+        SDL_RenderDrawRect(renderer, &outline);
+    }
+    
+    // The bar along the top is only a few blits, so it is always drawn
+    int width = framebuffer->w;
+    SDL_Rect bar = {0, 0, width, 50};
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderFillRect(renderer, &bar);
+    
+    drawCounter(textures, moves, 0);
+    Texture &face = game.lost() ? textures.dead : game.won() ? textures.glasses : textures.happy;
+    face.render(width / 2 - 15, 0);
+    textures.lightBulb.render(width / 2 + 15, -3);
+    drawCounter(textures, game.nMines - nFlags, width - 90);
+    
+    SDL_RenderFlush(renderer);
+}
+
+static bool savePNG(const std::string &dir, unsigned int seed, int frame)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%u_%04d.png", dir.c_str(), seed, frame);
+    if (IMG_SavePNG(framebuffer, path) < 0)
+    {
+        fprintf(stderr, "Unable to save %s! SDL_image Error: %s\n", path, IMG_GetError());
+        return false;
+    }
+    return true;
+}
+
+static bool writeRaw()
+{
+    bool success = true;
+    SDL_LockSurface(framebuffer);
+    // Rows may be padded, so write them one at a time
+    for (int y = 0; y < framebuffer->h && success; y++)
+    {
+        const char *row = (const char *)framebuffer->pixels + y * framebuffer->pitch;
+        success = fwrite(row, 3, framebuffer->w, stdout) == (size_t)framebuffer->w;
+    }
+    SDL_UnlockSurface(framebuffer);
+    return success;
+}
+
+// Starts game seed with the same first click as harness
+static void startGame(Game &game, unsigned int seed)
+{
+    game.reset(seed);
+    game.reveal(std::mt19937(seed)() % game.size);
+}
+
+// Makes a move as the solver gives it, with flags after the tiles
+static void makeMove(Game &game, int loc)
+{
+    if (loc >= game.size)
+        game.toggleFlag(loc - game.size);
+    else
+        game.reveal(loc);
+}
+
+// Plays game seed with the same moves as harness, keeping them in moves,
+// and returns whether the game was won. The solver's lookahead has a time
+// budget, so playing the game again needn't give the same moves.
+static bool play(Solver &solver, Game &game, unsigned int seed, std::vector<int> &moves)
+{
+    startGame(game, seed);
+    solver.setBoard(game.board.data(), game.cellState.data(), game.ncols, game.nrows, game.nMines);
+    solver.seed(seed);
+    
+    moves.clear();
+    while (!game.won() && !game.lost() && (int)moves.size() < 2 * game.size)
+    {
+        int loc = solver.singleSquare();
+        if (loc == -1)
+            loc = solver.multiSquare();
+        if (loc == -1)
+            break;
+        
+        moves.push_back(loc);
+        makeMove(game, loc);
+    }
+    return game.won();
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: replay [-games N] [-seed N] [-board COLS ROWS MINES] [-lost]\n"
+                    "              [-png DIR | -raw] [config]\n"
+                    "A config is a comma separated list of:\n"
+                    "  safest random lookahead ply2 nostrips nocount sample nosample\n");
+}
+
+int main(int argc, char *args[])
+{
+    int nGames = 1;
+    unsigned int firstSeed = 1;
+    int ncols = NCOLS;
+    int nrows = NROWS;
+    int nMines = NMINES;
+    bool onlyLost = false;
+    bool raw = false;
+    std::string pngDir;
+    SolverOptions options;
+    options.verbose = false;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(args[i], "-games") && i + 1 < argc)
+            nGames = atoi(args[++i]);
+        else if (!strcmp(args[i], "-seed") && i + 1 < argc)
+            firstSeed = (unsigned int)strtoul(args[++i], nullptr, 10);
+        else if (!strcmp(args[i], "-board") && i + 3 < argc)
+        {
+            ncols = atoi(args[++i]);
+            nrows = atoi(args[++i]);
+            nMines = atoi(args[++i]);
+        }
+        else if (!strcmp(args[i], "-lost"))
+            onlyLost = true;
+        else if (!strcmp(args[i], "-png") && i + 1 < argc)
+            pngDir = args[++i];
+        else if (!strcmp(args[i], "-raw"))
+            raw = true;
+        else if (!parseOptions(args[i], options))
+        {
+            fprintf(stderr, "Unknown config %s\n", args[i]);
+            usage();
+            return 1;
+        }
+    }
+    
+    if (raw == !pngDir.empty() || nGames < 1 || ncols < 1 || nrows < 1 || nMines < 0 || nMines >= ncols * nrows)
+    {
+        usage();
+        return 1;
+    }
+    
+    // Wide enough for the counters and face even on narrow boards
+    int width = std::max(ncols, 9) * TILE_WIDTH;
+    int height = nrows * TILE_HEIGHT + 50;
+    TextureStruct textures;
+    if (!initHeadless(width, height) || !loadMedia(textures))
+    {
+        fprintf(stderr, "Failed to initialize!\n");
+        return 1;
+    }
+    fprintf(stderr, "Frames are %dx%d\n", width, height);
+    
+    Game game(ncols, nrows, nMines);
+    Solver solver(nullptr, nullptr, 0, 0);
+    solver.setOptions(options);
+    std::vector<int> moves;
+    std::vector<int> drawn(game.size);
+    
+    int nFrames = 0;
+    double drawSeconds = 0;
+    double writeSeconds = 0;
+    bool success = true;
+    auto start = std::chrono::steady_clock::now();
+    
+    for (int n = 0; n < nGames && success; n++)
+    {
+        unsigned int seed = firstSeed + n;
+        bool won = play(solver, game, seed, moves);
+        if (onlyLost && won)
+            continue;
+        
+        // Draw the game from its moves, after the first click and after each one
+        std::fill(drawn.begin(), drawn.end(), IMAGE_NONE);
+        startGame(game, seed);
+        int frames = 0;
+        for (size_t i = 0; i <= moves.size() && success; i++)
+        {
+            if (i > 0)
+                makeMove(game, moves[i - 1]);
+            
+            auto drawStart = std::chrono::steady_clock::now();
+            drawFrame(textures, game, (int)i, drawn);
+            auto writeStart = std::chrono::steady_clock::now();
+            success = raw ? writeRaw() : savePNG(pngDir, seed, frames);
+            auto writeEnd = std::chrono::steady_clock::now();
+            
+            drawSeconds += std::chrono::duration<double>(writeStart - drawStart).count();
+            writeSeconds += std::chrono::duration<double>(writeEnd - writeStart).count();
+            frames++;
+        }
+        
+        nFrames += frames;
+        fprintf(stderr, "Game %u: %s after %d frames\n", seed, won ? "won" : "lost", frames);
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%d frames in %.2f s: %.2f s drawing, %.2f s writing\n",
+            nFrames, seconds, drawSeconds, writeSeconds);
+    
+    IMG_Quit();
+    SDL_Quit();
+    return success ? 0 : 1;
+}
@@ -1,8 +1,6 @@
 #ifndef shared_hpp
 #define shared_hpp
 
-#include "graphics.hpp"
-
 const int TILE_WIDTH = 30;
 const int TILE_HEIGHT = 30;
 const int NMINES = 40;
@@ -14,17 +12,9 @@ const int BOARDSIZE = NCOLS * NROWS;
 
 const int REVEALED = 1;
 const int FLAGGED = 2;
-
-// Counts number of mines. If 9, then it is a mine
-extern int board[BOARDSIZE];
-
-// cellState[loc] = 0 means unrevealed
-// cellState[loc] = 1 means revealed
-// cellState[loc] = 2 means flagged
-extern unsigned int cellState[BOARDSIZE];
-
-// The window renderer
-extern SDL_Renderer *renderer;
+// Revealed, but on the rim of an exported window so that some of its
+// neighbours are missing. Known to be safe, but its number can't be used.
+const int CLIPPED = 4;
 
 // Used to loop over adjacent cells
 struct Offset {
@@ -1,9 +1,90 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
 #include <vector>
 #include <utility>
 #include "solver.hpp"
 #include "shared.hpp"
+#include "stripsolver.hpp"
+#include "workpool.hpp"
+
+Solver::Solver(const int *board, const unsigned int *cellState, int ncols, int nrows, int nMines)
+{
+    lastGuessed = false;
+    storeEnd = 0;
+    this->ncols = 0;
+    this->nrows = 0;
+    setBoard(board, cellState, ncols, nrows, nMines);
+}
+
+void Solver::setBoard(const int *board, const unsigned int *cellState, int ncols, int nrows, int nMines)
+{
+    // Transpositions are keyed by location, which means
+    // different tiles in a window of another shape
+    if (ncols != this->ncols || nrows != this->nrows)
+        forget();
+    
+    this->board = board;
+    this->cellState = cellState;
+    this->ncols = ncols;
+    this->nrows = nrows;
+    this->nMines = nMines;
+    size = ncols * nrows;
+    density = -1;
+    logWeight = -INFINITY;
+    
+    // log n! for every n up to the number of tiles
+    if (logFactorials.empty())
+        logFactorials.push_back(0);
+    while ((int)logFactorials.size() <= size)
+        logFactorials.push_back(logFactorials.back() + log((double)logFactorials.size()));
+    probabilities.assign(size, -1);
+    errors.assign(size, 0);
+    parent.assign(size, -1);
+    componentOf.assign(size, -1);
+    tileIndex.assign(size, -1);
+    clearQueue();
+}
+
+void Solver::setDensity(double density)
+{
+    this->density = density;
+}
+
+void Solver::setOptions(const SolverOptions &options)
+{
+    this->options = options;
+}
+
+void Solver::seed(unsigned int seed)
+{
+    rng.seed(seed);
+    sampleRng.seed(~seed);
+    
+    // A new game starts with nothing remembered, so that it is played
+    // and timed the same whatever the solver was used for before
+    forget();
+    for (std::unique_ptr<Solver> &probe : probes)
+        if (probe)
+            probe->forget();
+}
+
+double Solver::probability(int loc)
+{
+    return probabilities[loc];
+}
+
+double Solver::probabilityError(int loc)
+{
+    return errors[loc];
+}
+
+bool Solver::guessed()
+{
+    return lastGuessed;
+}
 
 // Counts number of adjacent unrevealed tiles, adjacent flags,
 // and records which locations are unrevealed tiles
@@ -15,20 +96,20 @@ int Solver::countAdjacentUnrevealed(int loc, int &flagCount, bool adjacent[])
     
     for (int i = 0; i < 8; i++)
     {
-        int row = loc / NCOLS;
-        int col = loc % NCOLS;
+        int row = loc / ncols;
+        int col = loc % ncols;
         
         row += relPos[i].y;
         col += relPos[i].x;
         
-        if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS)
+        if (col >= 0 && col < ncols && row >= 0 && row < nrows)
         {
-            if (!cellState[row * NCOLS + col])
+            if (!cellState[row * ncols + col])
             {
                 adjacent[i] = true;
                 count++;
             }
-            else if (cellState[row * NCOLS + col] & FLAGGED)
+            else if (cellState[row * ncols + col] & FLAGGED)
             {
                 flagCount++;
             }
@@ -40,7 +121,7 @@ int Solver::countAdjacentUnrevealed(int loc, int &flagCount, bool adjacent[])
 int Solver::singleSquare()
 {
     bool adjacent[8];
-    for (int loc = 0; loc < BOARDSIZE; loc++)
+    for (int loc = 0; loc < size; loc++)
     {
         // If the square is not revealed, skip to next
         if (!(cellState[loc] & REVEALED))
@@ -58,10 +139,10 @@ int Solver::singleSquare()
                 {
                     if (adjacent[i])
                     {
-                        int col = (loc % NCOLS) + relPos[i].x;
-                        int row = (loc / NCOLS) + relPos[i].y;
-                        // For flagging, return loc + BOARDSIZE
-                        return row * NCOLS + col + BOARDSIZE;
+                        int col = (loc % ncols) + relPos[i].x;
+                        int row = (loc / ncols) + relPos[i].y;
+                        // For flagging, return loc + size
+                        return row * ncols + col + size;
                     }
                 }
             }
@@ -73,9 +154,9 @@ int Solver::singleSquare()
                 {
                     if (adjacent[i])
                     {
-                        int col = (loc % NCOLS) + relPos[i].x;
-                        int row = (loc / NCOLS) + relPos[i].y;
-                        return row * NCOLS + col;
+                        int col = (loc % ncols) + relPos[i].x;
+                        int row = (loc / ncols) + relPos[i].y;
+                        return row * ncols + col;
                     }
                 }
             }
@@ -90,14 +171,14 @@ bool Solver::isUnrevealedEdge(int loc)
 {
     for (const auto &rp : relPos)
     {
-        int row = loc / NCOLS;
-        int col = loc % NCOLS;
+        int row = loc / ncols;
+        int col = loc % ncols;
         
         row += rp.y;
         col += rp.x;
         
-        if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS)
-            if (cellState[row * NCOLS + col] & REVEALED)
+        if (col >= 0 && col < ncols && row >= 0 && row < nrows)
+            if (cellState[row * ncols + col] & REVEALED)
                 return true;
     }
     return false;
@@ -107,140 +188,844 @@ bool Solver::isRevealedEdge(int loc)
 {
     for (const auto &rp : relPos)
     {
-        int row = loc / NCOLS;
-        int col = loc % NCOLS;
+        int row = loc / ncols;
+        int col = loc % ncols;
         
         row += rp.y;
         col += rp.x;
         
-        if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS)
-            if (!cellState[row * NCOLS + col])
+        if (col >= 0 && col < ncols && row >= 0 && row < nrows)
+            if (!cellState[row * ncols + col])
                 return true;
     }
     return false;
 }
 
-int Solver::countAdjacentUnrevealed2(int loc)
+// Goes through every way of deciding the tiles from next on, given that the
+// ones before it have k mines between them. Stops once it is over budget.
+void Solver::findConfigs(Search &search, int next, int k)
 {
-    int count = 0;
-    for (const auto &rp : relPos)
+    if (--search.budget < 0)
+        return;
+    
+    if (next == search.graph.tiles())
     {
-        int row = loc / NCOLS;
-        int col = loc % NCOLS;
-        
-        row += rp.y;
-        col += rp.x;
-        
-        if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS && !cellState[row * NCOLS + col])
-            count += 1;
+        search.counts.add(search.config, k, 1);
+        return;
+    }
+    
+    for (int mine = 0; mine < 2; mine++)
+    {
+        search.config[next] = mine;
+        if (search.graph.decide(next, mine))
+            findConfigs(search, next + 1, k + mine);
+        search.graph.undo(next, mine);
     }
-    return count;
 }
 
-bool Solver::correctMineCount(int loc)
+ArenaVector<Solver::Component> Solver::splitComponents(const ArenaVector<int> &edgeUnrevealed,
+                                                       const ArenaVector<int> &edgeRevealed)
 {
-    int count = 0;
-    int contributingConfigCount = 0;
-    for (int i = 0; i < 8; i++)
+    // Union find over the unrevealed edge tiles. Tiles next to the same
+    // revealed tile have to be solved together.
+    for (const int &loc : edgeUnrevealed)
+        parent[loc] = loc;
+    
+    auto find = [this](int loc) {
+        while (parent[loc] != loc)
+            loc = parent[loc] = parent[parent[loc]];
+        return loc;
+    };
+    
+    for (const int &loc : edgeRevealed)
     {
-        int row = loc / NCOLS;
-        int col = loc % NCOLS;
-        
-        row += relPos[i].y;
-        col += relPos[i].x;
-        
-        if (col >= 0 && col < NCOLS && row >= 0 && row < NROWS)
+        int first = -1;
+        for (const auto &rp : relPos)
         {
-            int newLoc = row * NCOLS + col;
-            if (cellState[newLoc] & FLAGGED)
+            int row = loc / ncols + rp.y;
+            int col = loc % ncols + rp.x;
+            
+            if (col >= 0 && col < ncols && row >= 0 && row < nrows && !cellState[row * ncols + col])
             {
-                count += 1;
+                int root = find(row * ncols + col);
+                if (first == -1)
+                    first = root;
+                else if (root != first)
+                    parent[root] = first;
             }
-            else if (config.find(newLoc) != config.end())
+        }
+    }
+    
+    ArenaVector<Component> components(arena);
+    for (const int &loc : edgeUnrevealed)
+    {
+        int root = find(loc);
+        if (componentOf[root] == -1)
+        {
+            componentOf[root] = (int)components.size();
+            components.push_back(Component(arena));
+        }
+        components[componentOf[root]].unrevealed.push_back(loc);
+    }
+    
+    // Every unrevealed neighbour of a revealed edge tile is in the same component
+    for (const int &loc : edgeRevealed)
+    {
+        for (const auto &rp : relPos)
+        {
+            int row = loc / ncols + rp.y;
+            int col = loc % ncols + rp.x;
+            
+            if (col >= 0 && col < ncols && row >= 0 && row < nrows && !cellState[row * ncols + col])
             {
-                if (config[newLoc])
-                    count += 1;
-                
-                contributingConfigCount += 1;
+                components[componentOf[find(row * ncols + col)]].revealed.push_back(loc);
+                break;
             }
         }
     }
     
-    // The second predicate  of the else if relies on !(count > board[loc]), so the above if needs to be there.
-    if (count > board[loc])
-        return false;
-    // The second predicate is asking if there are enough adjacent tiles not currently in the configuration
-    // for there to be mines in to make up for the difference between the current count and board[loc].
-    else if (count == board[loc] || countAdjacentUnrevealed2(loc) - contributingConfigCount >= board[loc] - count)
-        return true;
+    for (const int &loc : edgeUnrevealed)
+        componentOf[loc] = -1;
+    return components;
+}
+
+// Small components aren't worth handing to the pool
+const int PARALLEL_MIN_TILES = 24;
+// Parallel searches are split into about this many tasks per thread
+const int TASKS_PER_THREAD = 8;
+
+static WorkPool &sharedPool()
+{
+    static WorkPool pool;
+    return pool;
+}
+
+ArenaVector<Constraint> Solver::buildConstraints(const Component &component)
+{
+    for (size_t i = 0; i < component.unrevealed.size(); i++)
+        tileIndex[component.unrevealed[i]] = (int)i;
     
-    return false;
+    ArenaVector<Constraint> constraints(arena);
+    for (const int &loc : component.revealed)
+    {
+        Constraint constraint(arena);
+        constraint.mines = board[loc];
+        
+        for (const auto &rp : relPos)
+        {
+            int row = loc / ncols + rp.y;
+            int col = loc % ncols + rp.x;
+            
+            if (col >= 0 && col < ncols && row >= 0 && row < nrows)
+            {
+                int newLoc = row * ncols + col;
+                if (cellState[newLoc] & FLAGGED)
+                    constraint.mines -= 1;
+                else if (!cellState[newLoc])
+                    constraint.tiles.push_back(tileIndex[newLoc]);
+            }
+        }
+        constraints.push_back(constraint);
+    }
+    
+    for (const int &loc : component.unrevealed)
+        tileIndex[loc] = -1;
+    return constraints;
 }
 
-bool Solver::isCompatibleConfig(std::vector<int> edgeRevealed)
+// Random descents used to estimate the size of a search tree
+const int TREE_PROBES = 64;
+// The estimate is often far too low for irregular components, so searches
+// are given this many times options.sampleAbove nodes before they give up
+// and the component is sampled instead
+const double SEARCH_BUDGET = 16;
+// Samples are split into this many batches, whose spread gives the error
+const int SAMPLE_BATCHES = 32;
+
+// Slots in the transposition table, and values in its store, 1 MB
+const size_t TRANSPOSITIONS = 256;
+const size_t TRANSPOSITION_STORE = 1 << 17;
+// What zobrist takes as the state of a tile that isn't showing a number
+const int ZOBRIST_UNREVEALED = 9;
+const int ZOBRIST_FLAGGED = 10;
+const int ZOBRIST_CLIPPED = 11;
+
+// Zobrist key of loc being in state. Mixed from both with splitmix64's
+// finaliser rather than looked up in a table, so that it works for any size.
+static uint64_t zobrist(int loc, int state)
 {
-    for (const int &loc : edgeRevealed)
-        if (!correctMineCount(loc))
+    uint64_t z = ((uint64_t)(uint32_t)loc << 8 | (uint8_t)state) + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static int zobristState(int number, unsigned int state)
+{
+    if (state & REVEALED)
+        return number;
+    if (state & FLAGGED)
+        return ZOBRIST_FLAGGED;
+    if (state & CLIPPED)
+        return ZOBRIST_CLIPPED;
+    return ZOBRIST_UNREVEALED;
+}
+
+// Copies the counts of a component matching key out of the transposition
+// table, if there is one
+bool Solver::recall(uint64_t key, const Component &component, Counts &counts)
+{
+    if (store.empty())
+        return false;
+    
+    const Transposition &entry = transpositions[key % TRANSPOSITIONS];
+    const ArenaVector<int> &cells = component.unrevealed;
+    int nTiles = (int)cells.size();
+    if (entry.key != key || entry.nTiles != nTiles || storeEnd - entry.start > store.size())
+        return false;
+    
+    const double *value = &store[entry.start % store.size()];
+    for (int i = 0; i < nTiles; i++)
+        if (*value++ != cells[i])
             return false;
+    
+    counts.reset(nTiles);
+    counts.logScale = *value++;
+    for (int k = 0; k <= nTiles; k++)
+        counts.configs[k] = *value++;
+    for (int i = 0; i < nTiles; i++)
+    {
+        for (int k = 0; k <= nTiles; k++)
+            counts.mines[i][k] = *value++;
+        for (int k = 0; k <= nTiles; k++)
+            counts.safes[i][k] = *value++;
+    }
     return true;
 }
 
-void Solver::findConfigs(std::vector<int> edgeUnrevealed, std::vector<int> edgeRevealed)
+// Keeps a component's counts in the transposition table, in place of
+// whatever was in its slot. Components too big to keep several of aren't.
+void Solver::remember(uint64_t key, const Component &component, const Counts &counts)
 {
-    if (edgeUnrevealed.size() == 0)
+    size_t nTiles = component.unrevealed.size();
+    size_t length = nTiles + 1 + (nTiles + 1) * (2 * nTiles + 1);
+    if (length > TRANSPOSITION_STORE / 4)
+        return;
+    
+    if (store.empty())
     {
-        listOfConfigs.push_back(config);
+        transpositions.assign(TRANSPOSITIONS, Transposition{0, -1, 0});
+        store.resize(TRANSPOSITION_STORE);
+    }
+    
+    // Entries don't wrap around the end of the store
+    size_t offset = storeEnd % store.size();
+    if (offset + length > store.size())
+        storeEnd += store.size() - offset;
+    
+    Transposition &entry = transpositions[key % TRANSPOSITIONS];
+    entry.key = key;
+    entry.nTiles = (int)nTiles;
+    entry.start = storeEnd;
+    
+    double *value = &store[storeEnd % store.size()];
+    for (const int &loc : component.unrevealed)
+        *value++ = loc;
+    *value++ = counts.logScale;
+    value = std::copy(counts.configs.begin(), counts.configs.end(), value);
+    for (size_t i = 0; i < nTiles; i++)
+    {
+        value = std::copy(counts.mines[i].begin(), counts.mines[i].end(), value);
+        value = std::copy(counts.safes[i].begin(), counts.safes[i].end(), value);
+    }
+    storeEnd += length;
+}
+
+// Empties the transposition table, keeping its memory
+void Solver::forget()
+{
+    // Every entry now starts more than a store's length back
+    storeEnd += store.size() + 1;
+}
+
+void Solver::solveComponent(const Component &component, Counts &counts, ArenaVector<Batch> &batches)
+{
+    int nTiles = (int)component.unrevealed.size();
+    ArenaVector<Constraint> constraints = buildConstraints(component);
+    
+    // The counts only depend on which tiles the component has and how many
+    // mines each of its numbers still needs, so that is all the key covers
+    uint64_t key = 0;
+    for (const int &loc : component.unrevealed)
+        key ^= zobrist(loc, ZOBRIST_UNREVEALED);
+    for (size_t c = 0; c < constraints.size(); c++)
+        key ^= zobrist(component.revealed[c], constraints[c].mines);
+    if (recall(key, component, counts))
+        return;
+    
+    // Edges are usually thin enough to count without searching
+    if (options.useStrips && countStrip(nTiles, constraints, MAX_STRIP_WIDTH, counts, arena))
+    {
+        remember(key, component, counts);
+        return;
+    }
+    
+    Search result(arena, ConstraintGraph(arena, nTiles, constraints));
+    
+    // Knuth's estimate of the number of nodes the search would visit. Not
+    // worth making if even a search of every configuration would be small
+    // enough, which with nTiles tiles has fewer than 2^(nTiles + 1) nodes.
+    // Its probes are seeded by the key, since whether they are made at all
+    // depends on what the table remembers.
+    double nodes = 0;
+    if (ldexp(1.0, nTiles + 1) > options.sampleAbove)
+    {
+        std::mt19937 probeRng((uint32_t)(key ^ key >> 32));
+        for (int i = 0; i < TREE_PROBES; i++)
+            nodes += sampleConfig(result, probeRng, nullptr) / TREE_PROBES;
+    }
+    
+    result.budget = options.sampleAbove * SEARCH_BUDGET;
+    if (nodes <= options.sampleAbove && searchComponent(result, counts))
+    {
+        remember(key, component, counts);
         return;
     }
     
-    for (int i = 0; i < 2; i++)
+    // Estimates aren't kept, since they come with batches for their errors.
+    // A search given up on leaves its counts, which the sampler's copies
+    // of it shouldn't take up room with.
+    result.counts = Counts(arena);
+    sampleComponent(result, counts, batches);
+}
+
+// Counts every configuration of result's component by searching them all.
+// Returns false if the search runs over result.budget nodes, on any thread.
+bool Solver::searchComponent(Search &result, Counts &counts)
+{
+    int nTiles = result.graph.tiles();
+    result.counts.reset(nTiles);
+    
+    WorkPool &pool = sharedPool();
+    if (nTiles < PARALLEL_MIN_TILES || pool.threads() < 2)
     {
-        // edgeUnrevealed is cut at the beginning each recursive call so
-        // that its 0th element is always the next spot to add to config.
-        config[edgeUnrevealed[0]] = i;
-        if (isCompatibleConfig(edgeRevealed))
+        findConfigs(result, 0, 0);
+        counts = result.counts;
+        return result.budget >= 0;
+    }
+    
+    // Each task fixes the first depth tiles to the bits of its task number
+    // and searches the rest. Every thread keeps its own counts.
+    int depth = 0;
+    while ((1 << depth) < pool.threads() * TASKS_PER_THREAD && depth < nTiles)
+        depth++;
+    
+    // The workers mustn't allocate, since the arena isn't thread safe, so
+    // everything they need is set up here. The task only captures two
+    // pointers, so std::function doesn't allocate either.
+    ArenaVector<Search> perThread(pool.threads(), result, arena);
+    struct
+    {
+        ArenaVector<Search> *perThread;
+        int depth;
+    } task = {&perThread, depth};
+    bool ran = pool.run(1 << depth, [this, &task](int n, int thread) {
+        Search &search = (*task.perThread)[thread];
+        int k = 0;
+        bool fits = true;
+        for (int i = 0; i < task.depth; i++)
         {
-            // The size-1 vector case must be handled separately like this
-            // because the edgeUnrevealed.begin() + 1 wouldn't make sense.
-            std::vector<int> newUnrevealed;
-            if (edgeUnrevealed.size() > 1)
-                newUnrevealed = std::vector<int> (edgeUnrevealed.begin() + 1, edgeUnrevealed.end());
+            search.config[i] = (n >> i) & 1;
+            k += search.config[i];
+            fits = search.graph.decide(i, search.config[i]) && fits;
+        }
+        
+        if (fits)
+            findConfigs(search, task.depth, k);
+        
+        for (int i = 0; i < task.depth; i++)
+            search.graph.undo(i, search.config[i]);
+    });
+    
+    // Another analysis has the pool, so do this one here
+    if (!ran)
+    {
+        findConfigs(result, 0, 0);
+        counts = result.counts;
+        return result.budget >= 0;
+    }
+    
+    // Each thread had the whole budget, since they run side by side
+    for (const Search &search : perThread)
+    {
+        if (search.budget < 0)
+            return false;
+        result.counts.add(search.counts);
+    }
+    counts = result.counts;
+    return true;
+}
+
+// One random descent through the search tree, choosing between mine and no
+// mine with equal chance wherever both keep the numbers satisfiable. If it
+// reaches a configuration, adds it to counts with weight the product of the
+// number of choices on the way, which makes the counts unbiased estimates of
+// the real ones. Returns the Knuth estimate of the size of the search tree.
+double Solver::sampleConfig(Search &search, std::mt19937 &rng, Counts *counts)
+{
+    int nTiles = search.graph.tiles();
+    double weight = 1;
+    double nodes = 1;
+    int k = 0;
+    
+    int depth;
+    for (depth = 0; depth < nTiles; depth++)
+    {
+        int choices[2];
+        int n = 0;
+        for (int mine = 0; mine < 2; mine++)
+        {
+            if (search.graph.decide(depth, mine))
+                choices[n++] = mine;
+            search.graph.undo(depth, mine);
+        }
+        
+        if (n == 0)
+            break;
+        search.config[depth] = choices[n == 1 ? 0 : rng() & 1];
+        search.graph.decide(depth, search.config[depth]);
+        k += search.config[depth];
+        weight *= n;
+        nodes += weight;
+    }
+    
+    if (depth == nTiles && counts)
+        counts->add(search.config, k, weight);
+    
+    for (int i = 0; i < depth; i++)
+        search.graph.undo(i, search.config[i]);
+    return nodes;
+}
+
+// Estimates the component's counts from options.samples random descents,
+// in batches spread over the pool. counts is the mean of the batches.
+void Solver::sampleComponent(const Search &search, Counts &counts, ArenaVector<Batch> &batches)
+{
+    int nTiles = search.graph.tiles();
+    counts.reset(nTiles);
+    batches.assign(SAMPLE_BATCHES, Batch(arena));
+    
+    // Batches are sampled a group at a time, each into its own table, which
+    // is added to counts in batch order and cleared for the next group. So
+    // only a group's worth of tables is ever needed, and the sums don't
+    // depend on which thread sampled what.
+    WorkPool &pool = sharedPool();
+    int group = std::min(pool.threads(), SAMPLE_BATCHES);
+    ArenaVector<Counts> tables(group, counts, arena);
+    
+    // Everything the tasks need is set up here, as for the parallel search
+    ArenaVector<Search> perThread(pool.threads(), search, arena);
+    ArenaVector<unsigned int> seeds(SAMPLE_BATCHES, 0, arena);
+    for (unsigned int &seed : seeds)
+        seed = sampleRng();
+    
+    struct
+    {
+        ArenaVector<Search> *perThread;
+        ArenaVector<Counts> *tables;
+        ArenaVector<unsigned int> *seeds;
+        int first;
+        int samples;
+    } task = {&perThread, &tables, &seeds, 0, std::max(1, options.samples / SAMPLE_BATCHES)};
+    auto sampleBatch = [this, &task](int n, int thread) {
+        std::mt19937 batchRng((*task.seeds)[task.first + n]);
+        for (int i = 0; i < task.samples; i++)
+            sampleConfig((*task.perThread)[thread], batchRng, &(*task.tables)[n]);
+    };
+    
+    for (task.first = 0; task.first < SAMPLE_BATCHES; task.first += group)
+    {
+        int n = std::min(group, SAMPLE_BATCHES - task.first);
+        if (pool.threads() < 2 || !pool.run(n, sampleBatch))
+            for (int b = 0; b < n; b++)
+                sampleBatch(b, 0);
+        
+        for (int b = 0; b < n; b++)
+        {
+            Counts &table = tables[b];
+            Batch &batch = batches[task.first + b];
+            batch.configs.assign(table.configs.begin(), table.configs.end());
+            batch.mines.assign(nTiles, 0);
+            for (int i = 0; i < nTiles; i++)
+                for (const double &m : table.mines[i])
+                    batch.mines[i] += m;
             
-            findConfigs(newUnrevealed, edgeRevealed);
+            counts.add(table);
+            table.clear();
+        }
+    }
+    
+    for (double &n : counts.configs)
+        n /= SAMPLE_BATCHES;
+    for (int i = 0; i < nTiles; i++)
+    {
+        for (size_t k = 0; k < counts.configs.size(); k++)
+        {
+            counts.mines[i][k] /= SAMPLE_BATCHES;
+            counts.safes[i][k] /= SAMPLE_BATCHES;
         }
-        config.erase(edgeUnrevealed[0]);
     }
 }
 
-void Solver::clearQueue()
+// log of n choose r. Uses a table rather than lgamma, which isn't thread safe.
+double Solver::logChoose(int n, int r)
 {
-    while (!moves.empty())
-        moves.pop();
+    return logFactorials[n] - logFactorials[r] - logFactorials[n - r];
 }
 
-int Solver::multiSquare()
+static ArenaVector<double> convolve(const ArenaVector<double> &a, const ArenaVector<double> &b)
 {
-    // See if there are any yet-to-be-made moves in queue from the last analysis
-    while (!moves.empty())
+    ArenaVector<double> result(a.size() + b.size() - 1, 0, a.get_allocator());
+    for (size_t i = 0; i < a.size(); i++)
+        for (size_t j = 0; j < b.size(); j++)
+            result[i + j] += a[i] * b[j];
+    return result;
+}
+
+// Polynomial in the number of mines, for part of the edge. terms[i] is for
+// low + i mines, times exp(logScale), so that the zero terms at either end
+// aren't kept and the rest never overflow.
+struct MinePolynomial
+{
+    ArenaVector<double> terms;
+    int low;
+    double logScale;
+    
+    MinePolynomial(const ArenaAllocator<double> &allocator) : terms(allocator), low(0), logScale(0) {}
+    
+    // Divides the terms by the biggest, which goes into logScale
+    void normalise()
     {
-        int loc = moves.front();
-        moves.pop();
+        double biggest = 0;
+        for (const double &t : terms)
+            biggest = std::max(biggest, t);
+        if (biggest == 0)
+            return;
         
-        printf("Move from previous analysis\n");
-        if (!cellState[loc > BOARDSIZE ? loc - BOARDSIZE : loc])
-            return loc;
+        for (double &t : terms)
+            t /= biggest;
+        logScale += log(biggest);
+    }
+};
+
+// A component's configurations by number of mines
+static MinePolynomial configPolynomial(const Counts &counts, Arena &arena)
+{
+    MinePolynomial p(arena);
+    size_t first = 0;
+    size_t end = counts.configs.size();
+    while (first < end && counts.configs[first] == 0)
+        first++;
+    while (end > first && counts.configs[end - 1] == 0)
+        end--;
+    
+    p.terms.assign(counts.configs.begin() + first, counts.configs.begin() + end);
+    p.low = (int)first;
+    p.logScale = counts.logScale;
+    p.normalise();
+    return p;
+}
+
+static MinePolynomial multiply(const MinePolynomial &a, const MinePolynomial &b)
+{
+    MinePolynomial product(a.terms.get_allocator());
+    if (a.terms.empty() || b.terms.empty())
+        return product;
+    
+    product.terms = convolve(a.terms, b.terms);
+    product.low = a.low + b.low;
+    product.logScale = a.logScale + b.logScale;
+    product.normalise();
+    return product;
+}
+
+// Given how likely each number of mines in parent is, works out how likely
+// each number in node is, summing over the ways its sibling can make up the
+// rest. Only the ratios between the weights matter, so they are normalised.
+static MinePolynomial passDown(const MinePolynomial &node, const MinePolynomial &sibling, const MinePolynomial &parent)
+{
+    MinePolynomial weights(node.terms.get_allocator());
+    weights.terms.assign(node.terms.size(), 0);
+    weights.low = node.low;
+    
+    // parent's terms start at node.low + sibling.low
+    for (size_t k = 0; k < node.terms.size(); k++)
+        for (size_t j = 0; j < sibling.terms.size(); j++)
+            weights.terms[k] += sibling.terms[j] * parent.terms[k + j];
+    weights.normalise();
+    return weights;
+}
+
+// Exponentiates log weights, scaled so that the biggest is 1
+static ArenaVector<double> fromLog(const ArenaVector<double> &logWeights)
+{
+    double biggest = -INFINITY;
+    for (const double &w : logWeights)
+        biggest = std::max(biggest, w);
+    
+    ArenaVector<double> weights(logWeights.size(), 0, logWeights.get_allocator());
+    if (biggest == -INFINITY)
+        return weights;
+    
+    for (size_t i = 0; i < weights.size(); i++)
+        weights[i] = exp(logWeights[i] - biggest);
+    return weights;
+}
+
+void Solver::weigh(const ArenaVector<Component> &components, ArenaVector<Counts> &counts,
+                   const ArenaVector<ArenaVector<Batch>> &batches, const ArenaVector<int> &unconstrained)
+{
+    // weights[c][k] is how likely a configuration of component c with k
+    // mines is, relative to the component's other configurations
+    ArenaVector<ArenaVector<double>> weights(components.size(), ArenaVector<double>(arena), arena);
+    double unconstrainedProbability = -1;
+    
+    int nFlags = 0;
+    for (int loc = 0; loc < size; loc++)
+        if (cellState[loc] & FLAGGED)
+            nFlags++;
+    
+    int left = nMines - nFlags;
+    int nFree = (int)unconstrained.size();
+    bool weighted = false;
+    logWeight = -INFINITY;
+    
+    if (nMines >= 0 && options.useMineCount)
+    {
+        // Configurations of the whole edge by number of mines, as a product
+        // tree over the components: leaf c, at nLeaves + c, is component c's
+        // configurations, and node n is the product of nodes 2n and 2n + 1.
+        // The root is node 1, which is leaf 0 if there's only one component.
+        int nLeaves = (int)counts.size();
+        ArenaVector<MinePolynomial> tree(std::max(2, 2 * nLeaves), MinePolynomial(arena), arena);
+        if (nLeaves == 0)
+            tree[1].terms.assign(1, 1.0);
+        for (int c = 0; c < nLeaves; c++)
+            tree[nLeaves + c] = configPolynomial(counts[c], arena);
+        for (int n = nLeaves - 1; n >= 1; n--)
+            tree[n] = multiply(tree[2 * n], tree[2 * n + 1]);
+        const MinePolynomial &all = tree[1];
+        
+        // A configuration of the whole edge with j mines can be completed
+        // in (nFree choose left - j) ways by the tiles off the edge. Scaled
+        // so that the biggest term of the total is 1; terms too small for a
+        // normal double count for nothing, so their ways don't have to fit.
+        ArenaVector<MinePolynomial> down(tree.size(), MinePolynomial(arena), arena);
+        MinePolynomial &ways = down[1];
+        ways.terms.assign(all.terms.size(), 0);
+        ways.low = all.low;
+        ArenaVector<double> logWays(all.terms.size(), -INFINITY, arena);
+        double biggest = -INFINITY;
+        for (size_t i = 0; i < all.terms.size(); i++)
+        {
+            int rest = left - (all.low + (int)i);
+            if (rest >= 0 && rest <= nFree && all.terms[i] >= DBL_MIN)
+            {
+                logWays[i] = logChoose(nFree, rest);
+                biggest = std::max(biggest, log(all.terms[i]) + logWays[i]);
+            }
+        }
+        for (size_t i = 0; i < all.terms.size(); i++)
+            if (logWays[i] > -INFINITY)
+                ways.terms[i] = exp(logWays[i] - biggest);
+        
+        double total = 0;
+        double freeMines = 0;
+        for (size_t i = 0; i < all.terms.size(); i++)
+        {
+            total += all.terms[i] * ways.terms[i];
+            if (nFree > 0)
+                freeMines += all.terms[i] * ways.terms[i] * ((left - all.low - (int)i) / (double)nFree);
+        }
+        
+        // Zero means the mine count can't be right, e.g. because of a wrong flag
+        if (total > 0)
+        {
+            weighted = true;
+            unconstrainedProbability = freeMines / total;
+            logWeight = all.logScale + biggest + log(total);
+            
+            // Each node's weights come from its parent's and its sibling's
+            // configurations, so no component's product of all the others is
+            // ever made
+            for (int n = 1; n < nLeaves; n++)
+            {
+                down[2 * n] = passDown(tree[2 * n], tree[2 * n + 1], down[n]);
+                down[2 * n + 1] = passDown(tree[2 * n + 1], tree[2 * n], down[n]);
+            }
+            
+            for (int c = 0; c < nLeaves; c++)
+            {
+                const MinePolynomial &leaf = down[nLeaves + c];
+                weights[c].assign(counts[c].configs.size(), 0);
+                for (size_t i = 0; i < leaf.terms.size(); i++)
+                    weights[c][leaf.low + i] = leaf.terms[i];
+            }
+        }
+    }
+    else if (density > 0 && density < 1)
+    {
+        // Every tile is a mine independently of the others
+        weighted = true;
+        unconstrainedProbability = density;
+        
+        logWeight = 0;
+        double odds = log(density / (1 - density));
+        for (size_t c = 0; c < counts.size(); c++)
+        {
+            // Scaled so that the biggest term of the total is 1, as with a mine count
+            const ArenaVector<double> &configs = counts[c].configs;
+            double biggest = -INFINITY;
+            for (size_t k = 0; k < configs.size(); k++)
+                if (configs[k] >= DBL_MIN)
+                    biggest = std::max(biggest, log(configs[k]) + k * odds);
+            weights[c].assign(configs.size(), 0);
+            for (size_t k = 0; k < configs.size(); k++)
+                if (configs[k] >= DBL_MIN)
+                    weights[c][k] = exp(k * odds - biggest);
+            
+            // Tiles of the component that aren't mines have weight 1 - density
+            double total = 0;
+            for (size_t k = 0; k < configs.size(); k++)
+                total += weights[c][k] * configs[k];
+            double n = (double)components[c].unrevealed.size();
+            logWeight += log(total) + biggest + n * log(1 - density) + counts[c].logScale;
+        }
     }
     
-    std::vector<int> edgeUnrevealed;
-    std::vector<int> edgeRevealed;
+    // Without a mine count, every configuration is as likely as any other
+    if (!weighted)
+    {
+        for (size_t c = 0; c < counts.size(); c++)
+            weights[c].assign(counts[c].configs.size(), 1.0);
+        
+        // A wrong mine count leaves no configurations at all
+        if (nMines < 0 || !options.useMineCount)
+        {
+            logWeight = 0;
+            for (const Counts &c : counts)
+            {
+                double total = 0;
+                for (const double &n : c.configs)
+                    total += n;
+                logWeight += log(total) + c.logScale;
+            }
+        }
+    }
+    
+    for (size_t c = 0; c < components.size(); c++)
+    {
+        const Counts &count = counts[c];
+        
+        double total = 0;
+        for (size_t k = 0; k < count.configs.size(); k++)
+            total += weights[c][k] * count.configs[k];
+        
+        // No valid configurations means a flag is wrong
+        if (total == 0)
+            continue;
+        
+        ArenaVector<double> batchTotals(batches[c].size(), 0, arena);
+        for (size_t b = 0; b < batches[c].size(); b++)
+            for (size_t k = 0; k < count.configs.size(); k++)
+                batchTotals[b] += weights[c][k] * batches[c][b].configs[k];
+        
+        for (size_t i = 0; i < components[c].unrevealed.size(); i++)
+        {
+            int loc = components[c].unrevealed[i];
+            double mine = 0;
+            double safe = 0;
+            for (size_t k = 0; k < count.configs.size(); k++)
+            {
+                mine += weights[c][k] * count.mines[i][k];
+                safe += weights[c][k] * count.safes[i][k];
+            }
+            probabilities[loc] = mine / total;
+            
+            // Sampled counts only give estimates, so nothing is certain. The
+            // error is the spread of the batches' estimates. Batches only
+            // keep each tile's mines summed over the number of mines, so
+            // those are weighed as the mean's are.
+            if (!batches[c].empty())
+            {
+                double unweighted = 0;
+                for (const double &m : count.mines[i])
+                    unweighted += m;
+                double weighting = unweighted > 0 ? mine / unweighted : 0;
+                
+                double sum = 0;
+                double squares = 0;
+                int n = 0;
+                for (size_t b = 0; b < batches[c].size(); b++)
+                {
+                    if (batchTotals[b] > 0)
+                    {
+                        double estimate = weighting * batches[c][b].mines[i] / batchTotals[b];
+                        sum += estimate;
+                        squares += estimate * estimate;
+                        n++;
+                    }
+                }
+                
+                double variance = n > 1 ? (squares - sum * sum / n) / (n - 1) : 0.25;
+                errors[loc] = sqrt(std::max(0.0, variance) / std::max(1, n));
+            }
+            // Flag
+            else if (safe == 0)
+                moves.push_back(loc + size);
+            // Open space
+            else if (mine == 0)
+                moves.push_back(loc);
+        }
+    }
+    
+    for (const int &loc : unconstrained)
+        probabilities[loc] = unconstrainedProbability;
+    
+    // The mine count can decide the tiles off the edge too, unless part of the edge was sampled
+    bool sampled = false;
+    for (const ArenaVector<Batch> &b : batches)
+        sampled = sampled || !b.empty();
+    if (weighted && nMines >= 0 && options.useMineCount && nFree > 0 && !sampled)
+    {
+        for (const int &loc : unconstrained)
+        {
+            if (unconstrainedProbability == 0)
+                moves.push_back(loc);
+            else if (unconstrainedProbability == 1)
+                moves.push_back(loc + size);
+        }
+    }
+}
+
+void Solver::analyse()
+{
+    // Nothing from the last analysis is needed any more
+    arena.reset();
+    
+    ArenaVector<int> edgeUnrevealed(arena);
+    ArenaVector<int> edgeRevealed(arena);
+    ArenaVector<int> unconstrained(arena);
     
     // Find all edge squares
-    for (int loc = 0; loc < BOARDSIZE; loc++)
+    for (int loc = 0; loc < size; loc++)
     {
         if (!cellState[loc])
         {
             if (isUnrevealedEdge(loc))
                 edgeUnrevealed.push_back(loc);
+            else
+                unconstrained.push_back(loc);
         }
         else if (cellState[loc] & REVEALED)
         {
@@ -249,48 +1034,323 @@ int Solver::multiSquare()
         }
     }
     
-    // Clear configs from previous analysis
-    config.clear();
-    listOfConfigs.clear();
+    probabilities.assign(size, -1);
+    errors.assign(size, 0);
+    clearQueue();
     
-    // Find all valid configurations
-    findConfigs(edgeUnrevealed, edgeRevealed);
+    // Solve each independent part of the edge. Sampled components
+    // also keep the batches of samples, to work out the error.
+    ArenaVector<Component> components = splitComponents(edgeUnrevealed, edgeRevealed);
+    ArenaVector<Counts> counts(components.size(), Counts(arena), arena);
+    ArenaVector<ArenaVector<Batch>> batches(components.size(), ArenaVector<Batch>(arena), arena);
+    for (size_t c = 0; c < components.size(); c++)
+        solveComponent(components[c], counts[c], batches[c]);
     
-    // Used to count how many configurations have mines/open spaces
-    // at each location.
-    std::vector<int> commonElements(BOARDSIZE, 0);
+    // Samples can all miss in a big enough component, which then says
+    // nothing about it, so its tiles are weighed as if they were off the
+    // edge. That only lets in more configurations, so whatever is certain
+    // still is.
+    size_t kept = 0;
+    for (size_t c = 0; c < components.size(); c++)
+    {
+        double found = 0;
+        for (const double &n : counts[c].configs)
+            found += n;
+        if (!batches[c].empty() && found == 0)
+        {
+            unconstrained.insert(unconstrained.end(), components[c].unrevealed.begin(), components[c].unrevealed.end());
+            continue;
+        }
+        
+        if (kept != c)
+        {
+            components[kept] = components[c];
+            counts[kept] = counts[c];
+            batches[kept] = batches[c];
+        }
+        kept++;
+    }
+    components.erase(components.begin() + kept, components.end());
+    counts.erase(counts.begin() + kept, counts.end());
+    batches.erase(batches.begin() + kept, batches.end());
+    
+    // Work out how likely each tile is to be a mine, and
+    // find locations that are open or mine in each config
+    weigh(components, counts, batches, unconstrained);
+}
+
+// The count tiles least likely to be mines, safest first, in random order
+// among equals, in memory from scratch
+ArenaVector<int> Solver::guessCandidates(int count, Arena &scratch)
+{
+    ArenaVector<int> candidates(scratch);
+    for (int loc = 0; loc < size; loc++)
+        if (!cellState[loc] && probabilities[loc] >= 0)
+            candidates.push_back(loc);
+    
+    std::shuffle(candidates.begin(), candidates.end(), rng);
+    std::stable_sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+        return probabilities[a] < probabilities[b];
+    });
+    if ((int)candidates.size() > count)
+        candidates.resize(count);
+    return candidates;
+}
+
+// Analyses the lookahead's current position. With ply 1 the survival is the
+// chance of the next move being safe; with more, it is the best score of the
+// position's candidates ply - 1 moves further on.
+Solver::Outlook Solver::evaluate(Lookahead &lookahead, int ply)
+{
+    // The same position can be worth more with more moves to look ahead
+    uint64_t key = lookahead.key ^ zobrist(-1, ply);
+    auto found = lookahead.memo.find(key);
+    if (found != lookahead.memo.end())
+        return found->second;
+    
+    // Every position ply moves ahead is analysed by the same solver, so its arena stays warm
+    if (probes.size() <= (size_t)ply)
+        probes.resize(ply + 1);
+    if (!probes[ply])
+        probes[ply].reset(new Solver(nullptr, nullptr, 0, 0));
+    Solver &probe = *probes[ply];
+    probe.setBoard(lookahead.board.data(), lookahead.cellState.data(), ncols, nrows, nMines);
+    probe.options = options;
+    probe.options.verbose = false;
+    probe.density = density;
+    // Seeded by the position, since a probe's random choices would otherwise
+    // depend on every position it analysed before
+    probe.rng.seed((uint32_t)(key ^ key >> 32));
+    probe.sampleRng.seed(~(uint32_t)(key ^ key >> 32));
+    probe.analyse();
     
-    // Add 1 if open, add 2 if mine
-    for (std::unordered_map<int, int> conf : listOfConfigs)
-        for (std::pair<int,int> p : conf)
-            commonElements[p.first] += p.second + 1;
+    Outlook outlook;
+    outlook.logWeight = probe.logWeight;
+    outlook.survival = 0;
     
-    // Find locations that are open in each config or mine in each config
-    for (int i = 0; i < BOARDSIZE; i++)
+    bool certain = false;
+    for (const int &move : probe.moves)
+        certain = certain || move < size;
+    
+    // Every tile left being a mine means the game is won
+    bool open = false;
+    bool known = false;
+    for (int loc = 0; loc < size; loc++)
     {
-        // Flag
-        if (commonElements[i] == 2 * listOfConfigs.size())
-            moves.push(i + BOARDSIZE);
-        // Open space
-        else if (commonElements[i] == listOfConfigs.size())
-            moves.push(i);
+        if (lookahead.cellState[loc])
+            continue;
+        open = open || probe.probabilities[loc] != 1;
+        if (probe.probabilities[loc] >= 0)
+        {
+            known = true;
+            outlook.survival = std::max(outlook.survival, 1 - probe.probabilities[loc]);
+        }
     }
     
-    // If any such locations were found
-    if (!moves.empty())
+    if (certain || !open)
+        outlook.survival = 1;
+    else if (!known)
+        outlook.survival = 0.5;
+    else if (ply > 1 && std::chrono::steady_clock::now() < lookahead.deadline)
     {
-        int loc = moves.front();
-        moves.pop();
-        return loc;
+        double best = 0;
+        for (const int &loc : probe.guessCandidates(options.lookaheadTiles, arena))
+            best = std::max(best, score(lookahead, loc, probe.probabilities[loc], ply - 1));
+        outlook.survival = best;
     }
     
-    // Move randomly if no move can be found
-    printf("Moving randomly.\n");
+    lookahead.memo[key] = outlook;
+    return outlook;
+}
+
+// Chance of loc being safe and of surviving ply more moves after revealing it,
+// averaged over every number it could turn out to be
+double Solver::score(Lookahead &lookahead, int loc, double mine, int ply)
+{
+    int flags = 0;
+    int unknown = 0;
+    for (const auto &rp : relPos)
+    {
+        int row = loc / ncols + rp.y;
+        int col = loc % ncols + rp.x;
+        if (col >= 0 && col < ncols && row >= 0 && row < nrows)
+        {
+            unsigned int state = lookahead.cellState[row * ncols + col];
+            if (state & FLAGGED)
+                flags++;
+            else if (!state)
+                unknown++;
+        }
+    }
+    
+    unsigned int oldState = lookahead.cellState[loc];
+    int oldNumber = lookahead.board[loc];
+    uint64_t oldKey = lookahead.key;
+    uint64_t hidden = oldKey ^ zobrist(loc, zobristState(oldNumber, oldState));
+    lookahead.cellState[loc] = REVEALED;
+    
+    // How likely each number is follows from the weight of
+    // the position it leaves, relative to the others
+    ArenaVector<double> logWeights(arena);
+    ArenaVector<double> survivals(arena);
+    logWeights.reserve(unknown + 1);
+    survivals.reserve(unknown + 1);
+    for (int n = flags; n <= flags + unknown; n++)
+    {
+        lookahead.board[loc] = n;
+        lookahead.key = hidden ^ zobrist(loc, n);
+        Outlook outlook = evaluate(lookahead, ply);
+        logWeights.push_back(outlook.logWeight);
+        survivals.push_back(outlook.survival);
+    }
+    
+    lookahead.cellState[loc] = oldState;
+    lookahead.board[loc] = oldNumber;
+    lookahead.key = oldKey;
+    
+    ArenaVector<double> weights = fromLog(logWeights);
+    double total = 0;
+    double expected = 0;
+    for (size_t n = 0; n < weights.size(); n++)
+    {
+        total += weights[n];
+        expected += weights[n] * survivals[n];
+    }
+    
+    if (total == 0)
+        return 0;
+    return (1 - mine) * expected / total;
+}
+
+int Solver::lookaheadGuess()
+{
+    ArenaVector<int> candidates = guessCandidates(options.lookaheadTiles, arena);
+    if (candidates.size() < 2)
+        return candidates.empty() ? -1 : candidates[0];
+    
+    Lookahead lookahead(arena);
+    lookahead.board.assign(board, board + size);
+    lookahead.cellState.assign(cellState, cellState + size);
+    // Kept up to date as tiles are revealed, rather than worked out for every position
+    lookahead.key = 0;
+    for (int loc = 0; loc < size; loc++)
+        lookahead.key ^= zobrist(loc, zobristState(board[loc], cellState[loc]));
+    lookahead.deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.lookaheadBudget));
+    
+    // Candidates are safest first, so running out of time still leaves a good pick
+    int best = candidates[0];
+    double bestScore = -1;
+    for (const int &loc : candidates)
+    {
+        if (loc != candidates[0] && std::chrono::steady_clock::now() >= lookahead.deadline)
+            break;
+        
+        double s = score(lookahead, loc, probabilities[loc], options.lookaheadPly);
+        
+        // Running out of time partway cuts the search short and inflates the
+        // score, so it can't be compared with the ones before
+        if (loc != candidates[0] && std::chrono::steady_clock::now() >= lookahead.deadline)
+            break;
+        if (s > bestScore + 1e-12)
+        {
+            best = loc;
+            bestScore = s;
+        }
+    }
+    
+    if (options.verbose)
+        printf("Guessing with a %.1f%% chance of a mine and a %.1f%% chance of surviving the next %d move(s).\n",
+               probabilities[best] * 100, bestScore * 100, options.lookaheadPly);
+    return best;
+}
+
+int Solver::guess()
+{
+    if (options.guess == GUESS_LOOKAHEAD)
+    {
+        int loc = lookaheadGuess();
+        if (loc != -1)
+            return loc;
+    }
+    
+    // Guess the tile least likely to be a mine, breaking ties randomly
+    double best = 2;
+    ArenaVector<int> candidates(arena);
+    for (int loc = 0; loc < size; loc++)
+    {
+        if (cellState[loc] || probabilities[loc] < 0)
+            continue;
+        
+        if (probabilities[loc] < best - 1e-9)
+        {
+            best = probabilities[loc];
+            candidates.clear();
+        }
+        if (probabilities[loc] < best + 1e-9)
+            candidates.push_back(loc);
+    }
+    
+    if (!candidates.empty() && options.guess == GUESS_SAFEST)
+    {
+        if (options.verbose)
+            printf("Guessing with a %.1f%% chance of a mine.\n", best * 100);
+        return candidates[rng() % candidates.size()];
+    }
+    
+    // Move randomly if asked to, or if nothing is known. A window exported from
+    // a ChunkBoard can be fully revealed, so make sure there is a move.
     int idx;
+    for (idx = 0; idx < size; idx++)
+        if (!cellState[idx])
+            break;
+    if (idx == size)
+        return -1;
+    
+    if (options.verbose)
+        printf("Moving randomly.\n");
     do
     {
-        idx = rand() % BOARDSIZE;
+        idx = rng() % size;
     } while (cellState[idx]);
     
     return idx;
 }
+
+std::vector<int> Solver::certainMoves()
+{
+    analyse();
+    return moves;
+}
+
+void Solver::clearQueue()
+{
+    moves.clear();
+    nextMove = 0;
+}
+
+int Solver::multiSquare()
+{
+    // See if there are any yet-to-be-made moves in queue from the last analysis
+    while (nextMove < moves.size())
+    {
+        int loc = moves[nextMove++];
+        
+        if (!cellState[loc >= size ? loc - size : loc])
+        {
+            if (options.verbose)
+                printf("Move from previous analysis\n");
+            lastGuessed = false;
+            return loc;
+        }
+    }
+    
+    analyse();
+    
+    // If any such locations were found
+    lastGuessed = moves.empty();
+    if (!moves.empty())
+        return moves[nextMove++];
+    
+    return guess();
+}
@@ -1,29 +1,214 @@
 #ifndef solver_hpp
 #define solver_hpp
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <queue>
-#include <unordered_set>
+#include <random>
 #include <unordered_map>
 #include "shared.hpp"
+#include "arena.hpp"
+#include "constraints.hpp"
+
+// How the solver picks a tile when nothing is certain
+enum GuessStrategy
+{
+    GUESS_RANDOM,   // Any unrevealed tile
+    GUESS_SAFEST,   // The tile least likely to be a mine
+    GUESS_LOOKAHEAD // Of the safest few tiles, the one most likely to survive the next moves too
+};
+
+struct SolverOptions
+{
+    GuessStrategy guess = GUESS_LOOKAHEAD;
+    // Count thin components with countStrip instead of searching
+    bool useStrips = true;
+    // Weigh configurations by the number of mines left on the board
+    bool useMineCount = true;
+    // Print what the solver is doing
+    bool verbose = true;
+    // For GUESS_LOOKAHEAD: how many tiles to consider, how many
+    // moves to look ahead, and how long one guess can take in seconds
+    int lookaheadTiles = 8;
+    int lookaheadPly = 1;
+    double lookaheadBudget = 0.05;
+    // Components whose search tree is estimated to have more nodes than this,
+    // or whose search runs far past it, are sampled instead of searched, with
+    // this many samples in total. Sampling never finds certain moves.
+    double sampleAbove = 1 << 20;
+    int samples = 1 << 14;
+};
 
 class Solver
 {
 public:
+    // Analyses an ncols x nrows window with nMines mines in total.
+    // nMines is -1 when it isn't known, e.g. for windows exported from a ChunkBoard.
+    Solver(const int *board, const unsigned int *cellState, int ncols, int nrows, int nMines = -1);
+    void setBoard(const int *board, const unsigned int *cellState, int ncols, int nrows, int nMines = -1);
+    // When nMines isn't known: the chance of any tile being a mine
+    void setDensity(double density);
+    void setOptions(const SolverOptions &options);
+    // Seeds the random choices made when guessing, for a new game, and
+    // forgets the components solved before so that games don't affect each other
+    void seed(unsigned int seed);
+    
+    // Both return a location in the window to move, or location + size
+    // if it should be flagged. singleSquare returns -1 if it finds nothing.
     int singleSquare();
     int multiSquare();
     void clearQueue();
+    // Chance of loc being a mine as of the last multiSquare analysis, or -1 if not known
+    double probability(int loc);
+    // Standard error of probability(loc), which is 0 unless it was sampled
+    double probabilityError(int loc);
+    // Whether the last move multiSquare returned was a guess
+    bool guessed();
+    // Analyses the window from scratch and returns every certain move found,
+    // encoded as for multiSquare. They stay queued for multiSquare to return.
+    std::vector<int> certainMoves();
 private:
-    std::queue<int> moves;
-    std::unordered_map<int, int> config;
-    std::vector<std::unordered_map<int, int>> listOfConfigs;
+    SolverOptions options;
+    std::mt19937 rng;
+    // Sampling has its own, so that guesses don't depend on whether it ran
+    std::mt19937 sampleRng;
+    bool lastGuessed;
+    const int *board;
+    const unsigned int *cellState;
+    int ncols;
+    int nrows;
+    int size;
+    int nMines;
+    double density;
+    std::vector<double> probabilities;
+    std::vector<double> errors;
+    // Certain moves found by the last analysis, and the next one to return
+    std::vector<int> moves;
+    size_t nextMove;
+    // Log of the total weight of every configuration as of the last analysis,
+    // comparable between positions with the same number of mines
+    double logWeight;
+    std::vector<double> logFactorials;
+    // Everything an analysis needs only while it runs. Reset at the
+    // start of each analysis, so it stops growing after a few moves.
+    Arena arena;
+    // Board sized scratch for splitting and building components, set up
+    // with the board. Whatever uses them puts back the entries it changed,
+    // so each component costs only its own tiles.
+    std::vector<int> parent;
+    std::vector<int> componentOf;
+    std::vector<int> tileIndex;
+    
+    // Unrevealed edge tiles that share revealed neighbours only with each
+    // other, and those revealed neighbours. Solved independently.
+    struct Component
+    {
+        ArenaVector<int> unrevealed;
+        ArenaVector<int> revealed;
+        
+        explicit Component(Arena &arena) : unrevealed(arena), revealed(arena) {}
+    };
+    
+    // State and results of a depth first search through a component's
+    // configurations. config[i] is 1 if the component's tile i is a mine,
+    // for the tiles the search has decided so far. budget is how many more
+    // nodes it may visit, and goes negative when it gives up.
+    struct Search
+    {
+        ArenaVector<int> config;
+        ConstraintGraph graph;
+        Counts counts;
+        double budget;
+        
+        Search(Arena &arena, const ConstraintGraph &graph)
+            : config(graph.tiles(), 0, arena), graph(graph), counts(arena), budget(0) {}
+    };
+    
+    // What is kept of a batch of samples to work out the error: the
+    // configurations of each number of mines it found, and how many of
+    // them have a mine at each tile, whatever their number of mines
+    struct Batch
+    {
+        ArenaVector<double> configs;
+        ArenaVector<double> mines;
+        
+        explicit Batch(Arena &arena) : configs(arena), mines(arena) {}
+    };
+    
+    // A hypothetical position's weight, and the chance of surviving the moves after it
+    struct Outlook
+    {
+        double logWeight;
+        double survival;
+    };
+    
+    // Scratch copy of the window that the lookahead reveals tiles in, its
+    // Zobrist key, and the outlooks of positions it has already been through.
+    // Everything comes from the solver's arena, which the analysis is done
+    // with by the time it guesses.
+    struct Lookahead
+    {
+        typedef std::unordered_map<uint64_t, Outlook, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                   ArenaAllocator<std::pair<const uint64_t, Outlook>>> Memo;
+        
+        ArenaVector<int> board;
+        ArenaVector<unsigned int> cellState;
+        uint64_t key;
+        Memo memo;
+        std::chrono::steady_clock::time_point deadline;
+        
+        explicit Lookahead(Arena &arena) : board(arena), cellState(arena), memo(Memo::allocator_type(arena)) {}
+    };
+    
+    // Solvers for the positions the lookahead looks at, one per ply, kept
+    // between guesses so that their arenas and transpositions stay warm
+    std::vector<std::unique_ptr<Solver>> probes;
+    
+    // Counts of a component an earlier analysis solved exactly, under the
+    // Zobrist key of the component's tiles and numbers
+    struct Transposition
+    {
+        uint64_t key;
+        int nTiles;
+        // Where the entry begins in the store, counted in values ever
+        // written, so that it is gone once the store has wrapped past it
+        size_t start;
+    };
+    
+    // Direct mapped by key, and kept until the window changes shape or a new
+    // game is seeded, so that components that haven't changed since the last
+    // analysis, usually most of them, aren't solved again
+    std::vector<Transposition> transpositions;
+    // Ring buffer of every entry's tiles, to check a match against, then its
+    // log scale and configs, then the mines and safes of each tile in turn. Newer entries
+    // write over the oldest, so the table never takes more than its size.
+    std::vector<double> store;
+    size_t storeEnd;
+    
     int countAdjacentUnrevealed(int loc, int &flagCount, bool adjacent[]);
-    int countAdjacentUnrevealed2(int loc);
     bool isUnrevealedEdge(int loc);
     bool isRevealedEdge(int loc);
-    void findConfigs(std::vector<int> edgeUnrevealed, std::vector<int> edgeRevealed);
-    bool correctMineCount(int loc);
-    bool isCompatibleConfig(std::vector<int> edgeRevealed);
+    void findConfigs(Search &search, int next, int k);
+    ArenaVector<Component> splitComponents(const ArenaVector<int> &edgeUnrevealed,
+                                           const ArenaVector<int> &edgeRevealed);
+    ArenaVector<Constraint> buildConstraints(const Component &component);
+    void solveComponent(const Component &component, Counts &counts, ArenaVector<Batch> &batches);
+    bool searchComponent(Search &result, Counts &counts);
+    bool recall(uint64_t key, const Component &component, Counts &counts);
+    void remember(uint64_t key, const Component &component, const Counts &counts);
+    void forget();
+    double sampleConfig(Search &search, std::mt19937 &rng, Counts *counts);
+    void sampleComponent(const Search &search, Counts &counts, ArenaVector<Batch> &batches);
+    double logChoose(int n, int r);
+    void weigh(const ArenaVector<Component> &components, ArenaVector<Counts> &counts,
+               const ArenaVector<ArenaVector<Batch>> &batches, const ArenaVector<int> &unconstrained);
+    void analyse();
+    int guess();
+    ArenaVector<int> guessCandidates(int count, Arena &scratch);
+    Outlook evaluate(Lookahead &lookahead, int ply);
+    double score(Lookahead &lookahead, int loc, double mine, int ply);
+    int lookaheadGuess();
 };
 
 #endif /* solver_hpp */
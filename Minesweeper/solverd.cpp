@@ -0,0 +1,321 @@
+// Solves positions sent by other processes over a Unix domain socket.
+// See protocol.hpp for what is sent. Requests from every connection go on one
+// queue, and workers take them off in batches. Replies go on their
+// connection's own queue, which a thread per connection writes out, so a
+// client that doesn't read its replies only holds up itself. Each worker keeps
+// one Solver for its lifetime, and they share the solver's work pool, so
+// nothing is set up again per request.
+//
+// solverd [-socket PATH] [-threads N]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "protocol.hpp"
+#include "solver.hpp"
+
+// Most requests a worker takes at once
+const size_t MAX_BATCH = 32;
+// Readers wait while this many requests are queued, so pipelining
+// clients can't queue up more than the workers can get through
+const size_t MAX_QUEUED = 4096;
+// A connection's requests stop being read while this many bytes of its
+// replies wait to be written
+const size_t MAX_OUTGOING = 1 << 22;
+
+struct Connection
+{
+    int fd;
+    std::mutex lock;
+    std::condition_variable changed;
+    // Replies waiting for the connection's writer
+    std::string outgoing;
+    // Requests queued that haven't been answered yet
+    size_t unanswered = 0;
+    bool reading = true;
+    // Writing failed, so replies are thrown away
+    bool broken = false;
+    
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+    
+    // Queues a reply for the writer, answering answered requests. Never
+    // waits for the client.
+    void send(const std::string &reply, size_t answered)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!broken)
+                outgoing += reply;
+            unanswered -= answered;
+        }
+        changed.notify_all();
+    }
+};
+
+struct Request
+{
+    std::shared_ptr<Connection> connection;
+    std::string line;
+};
+
+class RequestQueue
+{
+public:
+    void push(std::vector<Request> &requests)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notFull.wait(guard, [this] { return queue.size() < MAX_QUEUED; });
+        for (Request &request : requests)
+            queue.push_back(std::move(request));
+        requests.clear();
+        notEmpty.notify_all();
+    }
+    
+    // Waits for at least one request, then takes up to max
+    void pop(std::vector<Request> &requests, size_t max)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notEmpty.wait(guard, [this] { return !queue.empty(); });
+        while (!queue.empty() && requests.size() < max)
+        {
+            requests.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        notFull.notify_all();
+    }
+    
+private:
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<Request> queue;
+};
+
+static bool writeAll(int fd, const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        written += n;
+    }
+    return true;
+}
+
+// Splits what a connection sends into requests, queueing every
+// complete one read at once as one push
+static void readRequests(std::shared_ptr<Connection> connection, RequestQueue &queue)
+{
+    std::vector<char> buffer(1 << 16);
+    std::string partial;
+    std::vector<Request> requests;
+    
+    while (true)
+    {
+        ssize_t n = read(connection->fd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        
+        size_t start = 0;
+        for (size_t i = 0; i < (size_t)n; i++)
+        {
+            if (buffer[i] != '\n')
+                continue;
+            
+            partial.append(buffer.data() + start, i - start);
+            start = i + 1;
+            if (!partial.empty() && partial.back() == '\r')
+                partial.pop_back();
+            if (!partial.empty())
+                requests.push_back(Request{connection, std::move(partial)});
+            partial.clear();
+        }
+        partial.append(buffer.data() + start, n - start);
+        
+        // Requests that came before one too long are still answered
+        if (!requests.empty())
+        {
+            {
+                std::lock_guard<std::mutex> guard(connection->lock);
+                connection->unanswered += requests.size();
+            }
+            queue.push(requests);
+        }
+        
+        if (partial.size() > MAX_REQUEST)
+        {
+            connection->send(encodeError(-1, "request too long"), 0);
+            break;
+        }
+        
+        // Wait for the client to read its replies before taking more requests
+        std::unique_lock<std::mutex> guard(connection->lock);
+        connection->changed.wait(guard, [&] { return connection->outgoing.size() < MAX_OUTGOING || connection->broken; });
+        if (connection->broken)
+            break;
+    }
+    
+    // Replies can still be written until the last request is solved
+    shutdown(connection->fd, SHUT_RD);
+    {
+        std::lock_guard<std::mutex> guard(connection->lock);
+        connection->reading = false;
+    }
+    connection->changed.notify_all();
+}
+
+// Writes a connection's replies as they come, until the reader has stopped
+// and every request it read is answered
+static void writeReplies(std::shared_ptr<Connection> connection)
+{
+    std::string data;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(connection->lock);
+            connection->changed.wait(guard, [&] {
+                return !connection->outgoing.empty() || (!connection->reading && connection->unanswered == 0);
+            });
+            if (connection->outgoing.empty())
+                break;
+            data.swap(connection->outgoing);
+        }
+        // The reader may be waiting for room
+        connection->changed.notify_all();
+        
+        if (!writeAll(connection->fd, data))
+        {
+            {
+                std::lock_guard<std::mutex> guard(connection->lock);
+                connection->broken = true;
+                connection->outgoing.clear();
+            }
+            connection->changed.notify_all();
+            break;
+        }
+        data.clear();
+    }
+}
+
+static std::string solve(Solver &solver, const std::string &line)
+{
+    Position position;
+    std::string error;
+    if (!decodePosition(line, position, error))
+        return encodeError(position.id, error);
+    
+    solver.setBoard(position.board.data(), position.cellState.data(),
+                    position.ncols, position.nrows, position.nMines);
+    std::vector<int> moves = solver.certainMoves();
+    
+    std::vector<double> probabilities(position.board.size());
+    for (size_t loc = 0; loc < probabilities.size(); loc++)
+        probabilities[loc] = solver.probability((int)loc);
+    
+    return encodeReply(position.id, moves, probabilities);
+}
+
+static void work(RequestQueue &queue)
+{
+    SolverOptions options;
+    options.verbose = false;
+    Solver solver(nullptr, nullptr, 0, 0);
+    solver.setOptions(options);
+    
+    std::vector<Request> batch;
+    while (true)
+    {
+        batch.clear();
+        queue.pop(batch, MAX_BATCH);
+        
+        // Replies that pile up for a connection are written together
+        for (const Request &request : batch)
+            request.connection->send(solve(solver, request.line), 1);
+    }
+}
+
+int main(int argc, char *args[])
+{
+    std::string path = "/tmp/minesweeper.sock";
+    int nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(args[i], "-socket") && i + 1 < argc)
+            path = args[++i];
+        else if (!strcmp(args[i], "-threads") && i + 1 < argc)
+            nThreads = atoi(args[++i]);
+        else
+        {
+            printf("Usage: solverd [-socket PATH] [-threads N]\n");
+            return 1;
+        }
+    }
+    
+    if (nThreads < 1)
+    {
+        printf("Need at least one worker\n");
+        return 1;
+    }
+    
+    // A client going away shouldn't take the daemon with it
+    signal(SIGPIPE, SIG_IGN);
+    
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        printf("Socket path too long\n");
+        return 1;
+    }
+    strcpy(address.sun_path, path.c_str());
+    
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 64) < 0)
+    {
+        printf("Can't listen on %s: %s\n", path.c_str(), strerror(errno));
+        return 1;
+    }
+    printf("Listening on %s with %d workers\n", path.c_str(), nThreads);
+    fflush(stdout);
+    
+    RequestQueue queue;
+    for (int t = 0; t < nThreads; t++)
+        std::thread(work, std::ref(queue)).detach();
+    
+    while (true)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            printf("accept failed: %s\n", strerror(errno));
+            return 1;
+        }
+        std::shared_ptr<Connection> connection = std::make_shared<Connection>(fd);
+        std::thread(readRequests, connection, std::ref(queue)).detach();
+        std::thread(writeReplies, connection).detach();
+    }
+}
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include "stripsolver.hpp"
+
+// Polynomial in the number of mines for every state at a cut
+typedef std::unordered_map<uint64_t, ArenaVector<double>, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                           ArenaAllocator<std::pair<const uint64_t, ArenaVector<double>>>> Layer;
+
+static Layer makeLayer(Arena &arena)
+{
+    return Layer(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), arena);
+}
+
+// The polynomial for state, which starts out as length zeros if it's new
+static ArenaVector<double> &polynomial(Layer &layer, uint64_t state, size_t length)
+{
+    auto it = layer.find(state);
+    if (it == layer.end())
+        it = layer.emplace(state, ArenaVector<double>(length, 0, layer.get_allocator())).first;
+    return it->second;
+}
+
+// Divides every polynomial in layer by the biggest count in any of them,
+// and returns the log of what it divided by
+static double normalise(Layer &layer)
+{
+    double biggest = 0;
+    for (const auto &entry : layer)
+        for (const double &n : entry.second)
+            biggest = std::max(biggest, n);
+    if (biggest == 0)
+        return 0;
+    
+    for (auto &entry : layer)
+        for (double &n : entry.second)
+            n /= biggest;
+    return log(biggest);
+}
+
+// Orders tiles so that tiles sharing a constraint end up close together.
+// Breadth first search from an arbitrary tile finds one end of the strip,
+// and breadth first search from there orders the tiles along it.
+static ArenaVector<int> stripOrder(int nTiles, const ArenaVector<Constraint> &constraints, Arena &arena)
+{
+    ArenaVector<ArenaVector<int>> neighbours(nTiles, ArenaVector<int>(arena), arena);
+    for (const Constraint &c : constraints)
+        for (const int &a : c.tiles)
+            for (const int &b : c.tiles)
+                if (a != b)
+                    neighbours[a].push_back(b);
+    
+    ArenaVector<int> order(arena);
+    ArenaVector<char> seen(nTiles, false, arena);
+    auto search = [&](int start) {
+        seen.assign(nTiles, false);
+        order.clear();
+        order.push_back(start);
+        seen[start] = true;
+        
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            for (const int &n : neighbours[order[i]])
+            {
+                if (!seen[n])
+                {
+                    seen[n] = true;
+                    order.push_back(n);
+                }
+            }
+        }
+        
+        // Components are connected, but don't rely on it
+        for (int t = 0; t < nTiles; t++)
+            if (!seen[t])
+                order.push_back(t);
+    };
+    
+    search(0);
+    search(order.back());
+    return order;
+}
+
+bool countStrip(int nTiles, const ArenaVector<Constraint> &constraints, int maxWidth, Counts &counts, Arena &arena)
+{
+    counts.reset(nTiles);
+    if (nTiles == 0)
+        return true;
+    
+    ArenaVector<int> order = stripOrder(nTiles, constraints, arena);
+    ArenaVector<int> pos(nTiles, 0, arena);
+    for (int i = 0; i < nTiles; i++)
+        pos[order[i]] = i;
+    
+    // Position of each constraint's first and last tile, the constraints
+    // each position is in, and how many of their tiles come after it
+    int nConstraints = (int)constraints.size();
+    ArenaVector<int> first(nConstraints, nTiles, arena);
+    ArenaVector<int> last(nConstraints, -1, arena);
+    ArenaVector<ArenaVector<int>> touching(nTiles, ArenaVector<int>(arena), arena);
+    ArenaVector<ArenaVector<int>> after(nTiles, ArenaVector<int>(arena), arena);
+    for (int c = 0; c < nConstraints; c++)
+    {
+        const Constraint &constraint = constraints[c];
+        
+        // A number that can't be satisfied means there are no configurations
+        if (constraint.mines < 0 || constraint.mines > (int)constraint.tiles.size())
+            return true;
+        
+        for (const int &t : constraint.tiles)
+        {
+            first[c] = std::min(first[c], pos[t]);
+            last[c] = std::max(last[c], pos[t]);
+            
+            int remaining = 0;
+            for (const int &other : constraint.tiles)
+                if (pos[other] > pos[t])
+                    remaining++;
+            
+            touching[pos[t]].push_back(c);
+            after[pos[t]].push_back(remaining);
+        }
+    }
+    
+    // Constraints crossing the cut before each position, in the order
+    // their partial sums are packed into the state
+    ArenaVector<ArenaVector<int>> crossing(nTiles + 1, ArenaVector<int>(arena), arena);
+    for (int c = 0; c < nConstraints; c++)
+        for (int i = first[c] + 1; i <= last[c]; i++)
+            crossing[i].push_back(c);
+    
+    for (const ArenaVector<int> &cut : crossing)
+        if ((int)cut.size() > maxWidth || (int)cut.size() > MAX_STRIP_WIDTH)
+            return false;
+    
+    // Works out the state after the tile at position i, given the state
+    // before it and whether it is a mine. False if that breaks a constraint.
+    ArenaVector<int> sums(nConstraints, 0, arena);
+    auto step = [&](int i, uint64_t state, int mine, uint64_t &next) {
+        for (size_t s = 0; s < crossing[i].size(); s++)
+            sums[crossing[i][s]] = (state >> (4 * s)) & 0xF;
+        
+        for (size_t j = 0; j < touching[i].size(); j++)
+        {
+            int c = touching[i][j];
+            int sum = (first[c] == i ? 0 : sums[c]) + mine;
+            
+            // Too many mines, or too few tiles left to make up the number
+            if (sum > constraints[c].mines || sum + after[i][j] < constraints[c].mines)
+                return false;
+            sums[c] = sum;
+        }
+        
+        next = 0;
+        for (size_t s = 0; s < crossing[i + 1].size(); s++)
+            next |= (uint64_t)sums[crossing[i + 1][s]] << (4 * s);
+        return true;
+    };
+    
+    // forward[i][state][k] is the number of ways to fill in positions before i
+    // with k mines and end up in state, divided by exp(forwardScale[i]) so that
+    // long strips don't overflow
+    ArenaVector<Layer> forward(nTiles + 1, makeLayer(arena), arena);
+    ArenaVector<double> forwardScale(nTiles + 1, 0, arena);
+    polynomial(forward[0], 0, 1)[0] = 1;
+    for (int i = 0; i < nTiles; i++)
+    {
+        for (const auto &entry : forward[i])
+        {
+            for (int mine = 0; mine < 2; mine++)
+            {
+                uint64_t next;
+                if (!step(i, entry.first, mine, next))
+                    continue;
+                
+                ArenaVector<double> &poly = polynomial(forward[i + 1], next, i + 2);
+                for (size_t k = 0; k < entry.second.size(); k++)
+                    poly[k + mine] += entry.second[k];
+            }
+        }
+        forwardScale[i + 1] = forwardScale[i] + normalise(forward[i + 1]);
+    }
+    
+    // The last cut has no constraints crossing it, so there's one state
+    if (forward[nTiles].empty())
+        return true;
+    counts.configs = forward[nTiles].at(0);
+    counts.logScale = forwardScale[nTiles];
+    
+    // backward[state][k] is the number of ways to fill in the positions from
+    // i on with k mines, starting from state, divided by exp(backwardScale).
+    // Going backwards, combine it with forward to count the configurations
+    // with and without a mine at i.
+    Layer backward = makeLayer(arena);
+    double backwardScale = 0;
+    polynomial(backward, 0, 1)[0] = 1;
+    for (int i = nTiles - 1; i >= 0; i--)
+    {
+        Layer previous = makeLayer(arena);
+        int tile = order[i];
+        
+        for (const auto &entry : forward[i])
+        {
+            for (int mine = 0; mine < 2; mine++)
+            {
+                uint64_t next;
+                if (!step(i, entry.first, mine, next))
+                    continue;
+                
+                auto it = backward.find(next);
+                if (it == backward.end())
+                    continue;
+                const ArenaVector<double> &rest = it->second;
+                
+                ArenaVector<double> &poly = polynomial(previous, entry.first, nTiles - i + 1);
+                for (size_t k = 0; k < rest.size(); k++)
+                    poly[k + mine] += rest[k];
+                
+                ArenaVector<double> &total = mine ? counts.mines[tile] : counts.safes[tile];
+                for (size_t k1 = 0; k1 < entry.second.size(); k1++)
+                    for (size_t k2 = 0; k2 < rest.size(); k2++)
+                        total[k1 + k2 + mine] += entry.second[k1] * rest[k2];
+            }
+        }
+        
+        // The tile's counts come out scaled by both layers, not by the configs' scale
+        double rescale = exp(forwardScale[i] + backwardScale - counts.logScale);
+        for (size_t k = 0; k <= (size_t)nTiles; k++)
+        {
+            counts.mines[tile][k] *= rescale;
+            counts.safes[tile][k] *= rescale;
+        }
+        
+        backwardScale += normalise(previous);
+        backward.swap(previous);
+    }
+    
+    return true;
+}
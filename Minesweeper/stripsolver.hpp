@@ -0,0 +1,19 @@
+#ifndef stripsolver_hpp
+#define stripsolver_hpp
+
+#include "constraints.hpp"
+
+// Widest strip countStrip can handle. Every constraint crossing the cut
+// between two tiles needs 4 bits of the 64 bit state.
+const int MAX_STRIP_WIDTH = 16;
+
+// Counts the configurations of a component with dynamic programming over its
+// tiles, ordered along the long thin strip that the edge of the revealed area
+// usually is. The state after each tile is the partial sums of the
+// constraints that cross the cut after it, so the time taken is linear in the
+// length of the strip but exponential in its width. Returns false without
+// counting anything if more than maxWidth constraints cross any cut.
+// Scratch memory comes from arena.
+bool countStrip(int nTiles, const ArenaVector<Constraint> &constraints, int maxWidth, Counts &counts, Arena &arena);
+
+#endif /* stripsolver_hpp */
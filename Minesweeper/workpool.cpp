@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "workpool.hpp"
+
+WorkPool::WorkPool(int nThreads)
+{
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    
+    job = nullptr;
+    batch = 0;
+    busy = 0;
+    quit = false;
+    
+    for (int i = 0; i < nThreads; i++)
+        queues.push_back(std::unique_ptr<Queue>(new Queue));
+    for (int i = 0; i < nThreads; i++)
+        workers.push_back(std::thread(&WorkPool::work, this, i));
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+    wake.notify_all();
+    
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+int WorkPool::threads()
+{
+    return (int)workers.size();
+}
+
+bool WorkPool::run(int nTasks, const std::function<void(int task, int thread)> &fn)
+{
+    std::unique_lock<std::mutex> batchGuard(batchLock, std::try_to_lock);
+    if (!batchGuard.owns_lock())
+        return false;
+    
+    for (std::unique_ptr<Queue> &queue : queues)
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->tasks.clear();
+        queue->front = 0;
+    }
+    
+    // Deal the tasks out round robin. Neighbouring tasks tend to be similar
+    // in size, so this gives every thread a fair share to start with.
+    for (int i = 0; i < nTasks; i++)
+    {
+        Queue &queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(i);
+    }
+    
+    std::unique_lock<std::mutex> guard(lock);
+    job = &fn;
+    busy = (int)workers.size();
+    batch++;
+    wake.notify_all();
+    done.wait(guard, [this] { return busy == 0; });
+    job = nullptr;
+    return true;
+}
+
+bool WorkPool::takeTask(int thread, int &task)
+{
+    {
+        Queue &own = *queues[thread];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.tasks.size() > own.front)
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    
+    // Steal the oldest task of the next thread that has any
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        Queue &victim = *queues[(thread + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tasks.size() > victim.front)
+        {
+            task = victim.tasks[victim.front++];
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void WorkPool::work(int thread)
+{
+    unsigned int lastBatch = 0;
+    while (true)
+    {
+        const std::function<void(int, int)> *fn;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return quit || batch != lastBatch; });
+            if (quit)
+                return;
+            lastBatch = batch;
+            fn = job;
+        }
+        
+        int task;
+        while (takeTask(thread, task))
+            (*fn)(task, thread);
+        
+        std::lock_guard<std::mutex> guard(lock);
+        if (--busy == 0)
+            done.notify_one();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef workpool_hpp
+#define workpool_hpp
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// Fixed set of threads that run batches of tasks. Every thread has its own
+// queue of tasks and takes from the back of it, and a thread whose queue is
+// empty steals from the front of the others', so uneven tasks even out.
+class WorkPool
+{
+public:
+    // 0 threads means one per core
+    explicit WorkPool(int nThreads = 0);
+    ~WorkPool();
+    int threads();
+    
+    // Runs fn(task, thread) for every task in 0 ... nTasks - 1 and returns when
+    // all are done. thread says which of the pool's threads is running the task,
+    // so that tasks can keep results per thread without locking.
+    // Returns false without running anything if the pool is busy with another batch.
+    bool run(int nTasks, const std::function<void(int task, int thread)> &fn);
+
+private:
+    // Tasks are only added before a batch starts, so a vector and the index of
+    // its front will do, and keeps its memory from one batch to the next
+    struct Queue
+    {
+        std::mutex lock;
+        std::vector<int> tasks;
+        size_t front = 0;
+    };
+    
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::mutex batchLock;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int, int)> *job;
+    unsigned int batch;
+    int busy;
+    bool quit;
+    
+    bool takeTask(int thread, int &task);
+    void work(int thread);
+};
+
+#endif /* workpool_hpp */